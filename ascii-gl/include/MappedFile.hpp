@@ -0,0 +1,19 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <string>
+
+// Read only file mapped in memory. The pages are mapped copy on write,
+// so the data can still be modified in place without touching the file
+class MappedFile
+{
+public:
+  // returns nullptr if the file can't be opened or mapped
+  static Scope<MappedFile> Open(const std::string &path);
+
+  virtual ~MappedFile() = default;
+
+  virtual byte_t *Data() const = 0;
+  virtual size_t Size() const = 0;
+};
@@ -27,6 +27,9 @@ public:
   virtual void SetPixel(unsigned int x, unsigned int y, glm::vec4 color) override;
   virtual void SetPixel(unsigned int x, unsigned int y, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 0xff) override;
 
+  virtual void FillSpan(unsigned int x, unsigned int y, unsigned int length, uint32_t color) override;
+  virtual void WriteSpan(unsigned int x, unsigned int y, unsigned int length, const uint32_t *colors) override;
+
   // returns the number of bytes to be written onto the terminal buffer
   unsigned int length() const { return m_size - 1; }
 
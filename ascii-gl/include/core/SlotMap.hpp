@@ -0,0 +1,227 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Objects identified by generational ids, with O(1) creation, lookup and deletion.
+// An id packs the slot of the object (plus one, so 0 is never valid) in its INDEX_BITS low bits and the generation of
+// the slot in the other ones: deleting an object bumps the generation of its slot, so its stale ids never match the
+// object that reuses the slot. The objects are stored in blocks (never moved), the pointers to them stay valid until
+// they're deleted.
+//
+// Like the OpenGL names, a created id is only reserved: the object itself is constructed by Emplace (on bind).
+// Emplace accepts any id but 0, created or not: a free slot takes the generation of the id, so a deleted object can be
+// recreated under its id, and the ids the slots can't hold (negative, far past the last slot, or whose slot is used by
+// another generation) get their object in a separate map. Create never hands out an id twice, nor one of those
+template<class T>
+class SlotMap
+{
+public:
+  static constexpr unsigned int INDEX_BITS = 22;
+  static constexpr uint32_t MAX_SLOTS = (uint32_t(1) << INDEX_BITS) - 1;
+  static constexpr uint32_t MAX_GENERATION = (uint32_t(1) << (31 - INDEX_BITS)) - 1;
+
+  // Emplace doesn't grow the map by more slots than this at once, the ids further away go to the overflow map
+  static constexpr uint32_t MAX_GROWTH = uint32_t(1) << 16;
+
+public:
+  // reserves a free slot, 0 if there is none left
+  int Create()
+  {
+    for (;;)
+    {
+      uint32_t index;
+      if (!m_free.empty())
+      {
+        index = m_free.back();
+        m_free.pop_back();
+        m_slots[index].listed = false;
+
+        // the slots taken by Emplace stay in the free list
+        if (m_slots[index].state != State::FREE)
+          continue;
+      }
+      else
+      {
+        if (m_slots.size() >= MAX_SLOTS)
+          return 0;
+
+        index = uint32_t(m_slots.size());
+        Grow(index + 1);
+      }
+
+      // the id was bound before it was ever created, its generation is skipped
+      Slot &slot = m_slots[index];
+      if (m_overflow.contains(Id(index, slot.generation)))
+      {
+        Release(index);
+        continue;
+      }
+
+      slot.state = State::RESERVED;
+      return Id(index, slot.generation);
+    }
+  }
+
+  bool Contains(int id) const
+  {
+    const std::optional<uint32_t> index = Find(id);
+    if (index.has_value())
+      return m_slots[index.value()].state == State::ALIVE;
+    return m_overflow.contains(id);
+  }
+
+  T *Get(int id)
+  {
+    return const_cast<T *>(std::as_const(*this).Get(id));
+  }
+
+  const T *Get(int id) const
+  {
+    const std::optional<uint32_t> index = Find(id);
+    if (index.has_value())
+      return m_slots[index.value()].state == State::ALIVE ? &m_objects[index.value()].value() : nullptr;
+
+    typename std::map<int, T>::const_iterator it = m_overflow.find(id);
+    return it != m_overflow.end() ? &it->second : nullptr;
+  }
+
+  // the object of the id, constructed if needed, nullptr for 0 only
+  T *Emplace(int id)
+  {
+    if (!id)
+      return nullptr;
+
+    typename std::map<int, T>::iterator it = m_overflow.find(id);
+    if (it != m_overflow.end())
+      return &it->second;
+
+    if (!FitsSlot(id))
+      return &m_overflow[id];
+
+    const uint32_t index = Index(id);
+    if (index >= m_slots.size())
+      Grow(index + 1);
+
+    Slot &slot = m_slots[index];
+    // the generation of a free slot is the next one to hand out, the ones below it may have been
+    if (slot.state == State::FREE)
+    {
+      if (slot.generation)
+        slot.highest = uint16_t(std::max(uint32_t(slot.highest), slot.generation - 1));
+      slot.generation = Generation(id);
+    }
+    else if (slot.state == State::RETIRED || slot.generation != Generation(id))
+      return &m_overflow[id];
+
+    if (slot.state != State::ALIVE)
+    {
+      m_objects[index].emplace();
+      slot.state = State::ALIVE;
+    }
+    return &m_objects[index].value();
+  }
+
+  // destroys the object (or releases the reserved id)
+  void Erase(int id)
+  {
+    const std::optional<uint32_t> index = Find(id);
+    if (!index.has_value())
+    {
+      m_overflow.erase(id);
+      return;
+    }
+
+    m_objects[index.value()].reset();
+    Release(index.value());
+  }
+
+private:
+  enum class State : uint8_t
+  {
+    FREE,
+    RESERVED,
+    ALIVE,
+    RETIRED
+  };
+
+  struct Slot
+  {
+    uint32_t generation = 0;
+    uint16_t highest = 0; // generation handed out before a deleted id was emplaced again
+    State state = State::FREE;
+    bool listed = false;  // in the free list
+  };
+
+  static int Id(uint32_t index, uint32_t generation) { return int((generation << INDEX_BITS) | (index + 1)); }
+  static uint32_t Index(int id) { return (uint32_t(id) & MAX_SLOTS) - 1; }
+  static uint32_t Generation(int id) { return uint32_t(id) >> INDEX_BITS; }
+
+  // the id can have a slot: positive, with a valid index not too far past the last slot
+  bool FitsSlot(int id) const
+  {
+    return id > 0 && Index(id) < MAX_SLOTS && Index(id) < m_slots.size() + MAX_GROWTH;
+  }
+
+  // the slot moves to the next generation (retired if there is none left), and back to the free list
+  void Release(uint32_t index)
+  {
+    Slot &slot = m_slots[index];
+
+    const uint32_t last = std::max(slot.generation, uint32_t(slot.highest));
+    if (last == MAX_GENERATION)
+    {
+      slot.state = State::RETIRED;
+      return;
+    }
+
+    // the slots taken by Emplace may still be listed
+    slot.generation = last + 1;
+    slot.state = State::FREE;
+    if (!slot.listed)
+    {
+      slot.listed = true;
+      m_free.push_back(index);
+    }
+  }
+
+  // slot of a created (or emplaced) id
+  std::optional<uint32_t> Find(int id) const
+  {
+    if (id <= 0 || Index(id) >= m_slots.size())
+      return std::nullopt;
+
+    const Slot &slot = m_slots[Index(id)];
+    if (slot.generation != Generation(id) || (slot.state != State::RESERVED && slot.state != State::ALIVE))
+      return std::nullopt;
+    return Index(id);
+  }
+
+  // the new slots are free, the ones skipped by Emplace can still be created later on
+  void Grow(size_t size)
+  {
+    const size_t first = m_slots.size();
+    m_slots.resize(size);
+
+    // the last new slot is the caller's one, the lowest ones are reused first
+    for (size_t index = size - 1; index-- > first;)
+    {
+      m_slots[index].listed = true;
+      m_free.push_back(uint32_t(index));
+    }
+
+    while (m_objects.size() < size)
+      m_objects.emplace_back();
+  }
+
+private:
+  std::vector<Slot> m_slots;
+  std::deque<std::optional<T>> m_objects; // stable addresses
+  std::vector<uint32_t> m_free;
+  std::map<int, T> m_overflow; // objects of the ids without a slot, see Emplace
+};
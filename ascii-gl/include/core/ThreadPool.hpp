@@ -0,0 +1,111 @@
+#pragma once
+
+#include "core/Scope.hpp"
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <condition_variable>
+
+// Persistent pool of worker threads running the parallel stages of the pipeline.
+// The ranges are split in chunks queued on the workers, an idle worker steals the chunks queued on the other ones.
+// The calling thread works on the chunks as well, a range that isn't bigger than the grain size is run inline
+class ThreadPool
+{
+public:
+  // minimum number of elements of a chunk when the caller doesn't give one
+  static constexpr size_t DEFAULT_GRAIN_SIZE = 1024;
+
+  // 0 threads uses every hardware thread, 1 runs everything on the calling thread
+  ThreadPool(size_t threadCount = 0, size_t grainSize = DEFAULT_GRAIN_SIZE);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // number of threads working on a range, the calling thread included
+  void SetThreadCount(size_t threadCount);
+  size_t ThreadCount() const { return m_threads.size() + 1; }
+
+  void SetGrainSize(size_t grainSize) { m_grainSize = std::max<size_t>(1, grainSize); }
+  size_t GrainSize() const { return m_grainSize; }
+
+  // Calls `func(begin, end)` on chunks of [0, count), at least `grainSize` long (the pool's one if 0).
+  // Returns once the whole range is done
+  template<class Func>
+  void ParallelFor(size_t count, const Func &func, size_t grainSize = 0)
+  {
+    if (!grainSize)
+      grainSize = m_grainSize;
+
+    if (count <= grainSize || m_threads.empty())
+    {
+      if (count)
+        func(size_t(0), count);
+      return;
+    }
+
+    Job job;
+    job.func = &func;
+    job.run = [](const void *func, size_t begin, size_t end) {
+      (*static_cast<const Func *>(func))(begin, end);
+    };
+    return Run(job, count, grainSize);
+  }
+
+  // Calls `func(element)` on every element of [first, last)
+  template<class It, class Func>
+    requires std::random_access_iterator<It>
+  void ForEach(It first, It last, const Func &func, size_t grainSize = 0)
+  {
+    return ParallelFor(size_t(last - first), [first, &func](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        func(first[i]);
+    }, grainSize);
+  }
+
+private:
+  struct Job
+  {
+    void (*run)(const void *func, size_t begin, size_t end) = nullptr;
+    const void *func = nullptr;
+    std::atomic<size_t> remaining = 0; // chunks not done yet
+  };
+
+  struct Task
+  {
+    Job *job;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Run(Job &job, size_t count, size_t grainSize);
+
+  // runs one task, from the queue `own` first (if any) and then stolen from the other ones, returns false if none was found
+  bool RunTask(size_t own);
+
+  void Start(size_t workerCount);
+  void Stop();
+  void Work(size_t index);
+
+private:
+  std::vector<std::thread> m_threads;
+  std::vector<Scope<Queue>> m_queues; // one per worker
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  std::atomic<size_t> m_pending = 0; // queued tasks
+  bool m_stop = false;
+
+  size_t m_grainSize;
+};
@@ -2,6 +2,8 @@
 
 
 #include "graphics/IVertex.hpp"
+#include "graphics/VertexLayout.hpp"
+#include "graphics/VertexStreams.hpp"
 
 #include "core/types.h"
 #include <vector>
@@ -23,7 +25,8 @@ public:
     m_vertexSize = 0;
     m_bufferSize = 0;
 
-    delete[] m_bufferData;
+    if (!m_mapping)
+      delete[] m_bufferData;
     m_bufferData = nullptr;
   };
 
@@ -31,6 +34,16 @@ public:
   {
     m_vertexCount = 0;
     m_vertexSize = 0;
+    m_layout.Clear();
+    m_streams.Clear();
+    m_mapFirst = m_mapEnd = 0;
+
+    // the mapped memory is released right away
+    if (m_mapping)
+    {
+      m_mapping.reset();
+      m_bufferData = nullptr;
+    }
   }
 
   size_t Size() const { return m_vertexSize; }
@@ -40,18 +53,76 @@ public:
   {
     m_vertexCount = std::min(other.m_vertexCount, vertexLimit);
     m_vertexSize = other.m_vertexSize;
+    m_isIVertex = other.m_isIVertex;
+    m_layout = other.m_layout;
+    m_storage = other.m_storage;
+    m_streamsDirty = true;
 
     size_t dataSize = m_vertexCount * m_vertexSize;
-    if (m_bufferSize < dataSize)
-    {
-      m_bufferSize = dataSize;
-      delete[] m_bufferData;
-      m_bufferData = new byte_t[m_bufferSize];
-    }
+    Reserve(dataSize);
 
     std::memcpy(m_bufferData, other.m_bufferData, dataSize);
   }
 
+  // Uses `vertexCount` vertices of `vertexSize` bytes stored at `data` in place (no copy), e.g. a mapped file.
+  // `owner` keeps the memory alive as long as the buffer uses it, the attributes must be described with SetAttribute
+  void SetMapped(size_t vertexSize, size_t vertexCount, byte_t *data, Ref<void> owner)
+  {
+    if (!m_mapping)
+      delete[] m_bufferData;
+
+    m_vertexSize = vertexSize;
+    m_vertexCount = vertexCount;
+    m_isIVertex = false;
+    m_streamsDirty = true;
+
+    m_bufferSize = 0;
+    m_bufferData = data;
+    m_mapping = std::move(owner);
+    m_mapFirst = m_mapEnd = 0;
+  }
+
+  bool IsMapped() const { return m_mapping != nullptr; }
+
+  // copies `count` vertices over the ones from `first` (no reallocation), returns false if they aren't all in the buffer
+  bool SetRange(size_t first, size_t count, const void *vertices)
+  {
+    if (!IsInBuffer(first, count))
+      return false;
+
+    std::memcpy(m_bufferData + first * m_vertexSize, vertices, count * m_vertexSize);
+    Invalidate(first, first + count);
+    return true;
+  }
+
+  // Direct access to the vertices [first, first + count), nullptr if they aren't all in the buffer.
+  // The pointer stays valid until the buffer is reallocated, the written vertices are reported with Flush or Unmap
+  byte_t *Map(size_t first, size_t count)
+  {
+    if (!IsInBuffer(first, count))
+      return nullptr;
+
+    m_mapFirst = first;
+    m_mapEnd = first + count;
+    return m_bufferData + first * m_vertexSize;
+  }
+
+  // the vertices [first, first + count) of the mapped range were written
+  void Flush(size_t first, size_t count)
+  {
+    if (m_mapFirst + first < m_mapEnd)
+      Invalidate(m_mapFirst + first, std::min(m_mapEnd, m_mapFirst + first + count));
+  }
+
+  // the whole mapped range may have been written
+  void Unmap()
+  {
+    Invalidate(m_mapFirst, m_mapEnd);
+    m_mapFirst = m_mapEnd = 0;
+  }
+
+  bool IsMapActive() const { return m_mapFirst < m_mapEnd; }
+
   template<class Vertex>
     requires IsVertex<Vertex>
   void Set(const std::vector<Vertex> &vertices) { return Set(vertices.size(), vertices.data()); }
@@ -66,15 +137,11 @@ public:
   {
     m_vertexSize = sizeof(Vertex);
     m_vertexCount = size;
+    m_isIVertex = std::is_base_of_v<IVertex, Vertex>;
+    m_streamsDirty = true;
 
     const size_t dataSize = m_vertexSize * m_vertexCount;
-    if (m_bufferSize < dataSize)
-    {
-      m_bufferSize = dataSize;
-
-      delete[] m_bufferData;
-      m_bufferData = new byte_t[m_bufferSize];
-    }
+    Reserve(dataSize);
 
     std::memcpy(m_bufferData, vertices, dataSize);
   }
@@ -90,22 +157,117 @@ public:
     requires IsVertex<Vertex>
   const Vertex &Get(size_t index) const
   {
-    return *reinterpret_cast<Vertex *>(Data(index));
+    return *reinterpret_cast<const Vertex *>(Data(index));
   }
 
   void *Data(size_t index = 0) { return m_bufferData + (m_vertexSize * index); }
   const void *Data(size_t index = 0) const { return m_bufferData + (m_vertexSize * index); }
 
+  // only valid if the stored vertices inherit IVertex
   IVertex &Vertex(size_t index) { return *static_cast<IVertex *>(Data(index)); }
   const IVertex &Vertex(size_t index) const { return *static_cast<const IVertex *>(Data(index)); }
+  bool IsIVertex() const { return m_isIVertex; }
+
+  const VertexLayout &Layout() const { return m_layout; }
+
+  void SetAttribute(unsigned int index, const VertexAttrib &attribute)
+  {
+    m_layout.SetAttribute(index, attribute);
+    m_streamsDirty = true;
+  }
+
+  void Fetch(size_t index, VertexAttributes &attributes) const
+  {
+    return m_layout.Fetch(static_cast<const byte_t *>(Data(index)), attributes);
+  }
+
+  void SetStorage(gl::StorageMode storage)
+  {
+    m_storage = storage;
+    m_streamsDirty = true;
+  }
+  gl::StorageMode GetStorage() const { return m_storage; }
+
+  // (re)builds the streams if the buffer is stored as a structure of arrays and its data or layout changed since,
+  // only the vertices written with SetRange or through Map are converted again if the rest didn't change
+  void UpdateStreams()
+  {
+    if (!m_streamsDirty)
+    {
+      if (m_dirtyFirst < m_dirtyEnd && !m_streams.Empty())
+        m_streams.Update(m_bufferData, m_vertexSize, m_dirtyFirst, m_dirtyEnd, m_layout);
+      m_dirtyFirst = m_dirtyEnd = 0;
+      return;
+    }
+
+    if (m_storage == gl::STRUCTURE_OF_ARRAYS && !m_layout.Empty())
+      m_streams.Build(m_bufferData, m_vertexSize, m_vertexCount, m_layout);
+    else
+      m_streams.Clear();
+    m_streamsDirty = false;
+    m_dirtyFirst = m_dirtyEnd = 0;
+  }
+
+  // empty unless the buffer is stored as a structure of arrays (and has a layout), see VertexBatch::Transform
+  const VertexStreams &Streams() const { return m_streams; }
 
   byte_t *operator*() { return m_bufferData; }
   const byte_t *operator*() const { return m_bufferData; }
 
+private:
+  bool IsInBuffer(size_t first, size_t count) const
+  {
+    return count <= m_vertexCount && first <= m_vertexCount - count;
+  }
+
+  // the vertices [first, end) changed, their streams are converted again on the next draw
+  void Invalidate(size_t first, size_t end)
+  {
+    if (first >= end)
+      return;
+
+    m_dirtyFirst = m_dirtyFirst < m_dirtyEnd ? std::min(m_dirtyFirst, first) : first;
+    m_dirtyEnd = std::max(m_dirtyEnd, end);
+  }
+
+  // makes sure the buffer owns at least `dataSize` bytes, a mapped buffer always gets its own storage back
+  void Reserve(size_t dataSize)
+  {
+    m_mapFirst = m_mapEnd = 0;
+
+    if (m_mapping)
+    {
+      m_mapping.reset();
+      m_bufferData = nullptr;
+      m_bufferSize = 0;
+    }
+
+    if (m_bufferSize < dataSize)
+    {
+      m_bufferSize = dataSize;
+
+      delete[] m_bufferData;
+      m_bufferData = new byte_t[m_bufferSize];
+    }
+  }
+
 private:
   size_t m_vertexCount = 0;
   size_t m_vertexSize = 0;
 
   size_t m_bufferSize = 0;
   byte_t *m_bufferData = nullptr;
+  Ref<void> m_mapping; // set if m_bufferData isn't owned (see SetMapped)
+
+  bool m_isIVertex = false;
+  VertexLayout m_layout;
+
+  gl::StorageMode m_storage = gl::INTERLEAVED;
+  VertexStreams m_streams;
+  bool m_streamsDirty = false;
+  size_t m_dirtyFirst = 0; // vertices changed in place since the streams were built
+  size_t m_dirtyEnd = 0;
+
+  size_t m_mapFirst = 0; // vertices handed out by Map
+  size_t m_mapEnd = 0;
 };
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace gl
+{
+  // Pipeline states that can be toggled with gl::Enable / gl::Disable
+  enum class Capability
+  {
+    CULL_FACE,
+    DEPTH_TEST,
+  };
+
+  using enum Capability;
+
+  enum class Face
+  {
+    FRONT,
+    BACK,
+    FRONT_AND_BACK
+  };
+
+  using enum Face;
+
+  // winding order (in normalized device coordinates) of the front facing triangles
+  enum class Winding
+  {
+    CW,
+    CCW
+  };
+
+  using enum Winding;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "core/types.h"
+
+#include "graphics/gl.hpp"
+#include "graphics/Shader.hpp"
+#include "graphics/Pipeline.hpp"
+
+#include <map>
+#include <vector>
+#include <cstring>
+#include <optional>
+#include <type_traits>
+
+namespace gl
+{
+  // Records binds, uniform uploads and draw calls to execute them later with gl::Submit.
+  // Recording doesn't touch the context, so several lists can be recorded at the same time (one per thread).
+  // The capabilities and the viewport are the ones of the context when the list is submitted
+  class CommandList
+  {
+  public:
+    // executes a recorded draw, `indices` is null for the draws of the bound element buffer (starting at `offset`)
+    using DrawFunction = void (*)(RenderMode mode, size_t count, const int *indices, size_t offset, size_t instanceCount);
+    using UploadFunction = void (*)(Program &program, int location, const byte_t *value);
+
+    struct DrawCommand
+    {
+      // bound state of the draw
+      int program;
+      int buffer;
+      int instanceBuffer;
+      int elementBuffer;
+
+      // number of uniforms uploaded to the program before the draw, the draws are never moved across an upload
+      size_t uniforms;
+
+      RenderMode mode;
+      DrawFunction function;
+      bool elements;    // draws `count` indices of the element buffer from `first`, otherwise of the recorded indices
+      size_t first;
+      size_t count;
+      size_t instanceCount;
+    };
+
+    struct UniformCommand
+    {
+      int program;
+      int location;
+      size_t offset; // in the recorded uniform values
+      UploadFunction upload;
+    };
+
+  public:
+    void Clear();
+    bool Empty() const { return m_draws.empty() && m_uniforms.empty(); }
+
+    void BindBuffer(int bufferId) { m_buffer = bufferId; }
+    void BindInstanceBuffer(int bufferId) { m_instanceBuffer = bufferId; }
+    void BindElementBuffer(int bufferId) { m_elementBuffer = bufferId; }
+    void UseProgram(int programId) { m_program = programId; }
+
+    // the locations must be resolved beforehand (gl::GetUniformLocation), the value is copied
+    template<class T>
+      requires std::is_trivially_copyable_v<std::remove_cvref_t<T>>
+    void Uniform(int programId, int location, const T &value)
+    {
+      using U = std::remove_cvref_t<T>;
+
+      // every value starts on a 16 bytes boundary so it can be read in place
+      const size_t offset = m_uniformData.size();
+      m_uniformData.resize(offset + (sizeof(U) + 15) / 16 * 16);
+      std::memcpy(m_uniformData.data() + offset, &value, sizeof(U));
+
+      m_uniforms.push_back({ programId, location, offset, &Upload<U> });
+      ++m_uploads[programId];
+    }
+
+    void DrawElements(RenderMode mode, const std::vector<int> &indices);
+    void DrawElements(RenderMode mode, size_t indicesCount, const int *indices);
+    void DrawElementBuffer(RenderMode mode, size_t count, size_t offset = 0);
+
+    void DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount);
+    void DrawElementsInstanced(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount);
+    void DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount);
+
+    // typed draw calls, executed with the vertex stage of gl::DrawElements<Vertex, VertexShader>
+    template<class Vertex, class VertexShader>
+      requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+    void DrawElements(RenderMode mode, const std::vector<int> &indices)
+    {
+      return RecordIndices(mode, indices.size(), indices.data(), 1, &TypedDraw<Vertex, VertexShader>);
+    }
+
+    template<class Vertex, class VertexShader>
+      requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+    void DrawElements(RenderMode mode, size_t indicesCount, const int *indices)
+    {
+      return RecordIndices(mode, indicesCount, indices, 1, &TypedDraw<Vertex, VertexShader>);
+    }
+
+    template<class Vertex, class VertexShader>
+      requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+    void DrawElementBuffer(RenderMode mode, size_t count, size_t offset = 0)
+    {
+      return RecordElements(mode, count, offset, 1, &TypedDraw<Vertex, VertexShader>);
+    }
+
+    template<class Vertex, class VertexShader>
+      requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+    void DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount)
+    {
+      return RecordIndices(mode, indices.size(), indices.data(), instanceCount, &TypedDraw<Vertex, VertexShader>);
+    }
+
+    template<class Vertex, class VertexShader>
+      requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+    void DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount)
+    {
+      return RecordElements(mode, count, offset, instanceCount, &TypedDraw<Vertex, VertexShader>);
+    }
+
+    const std::vector<DrawCommand> &Draws() const { return m_draws; }
+    const std::vector<UniformCommand> &Uniforms() const { return m_uniforms; }
+    const int *Indices(size_t first = 0) const { return m_indices.data() + first; }
+    const byte_t *UniformData(size_t offset) const { return m_uniformData.data() + offset; }
+
+    // bind state once every recorded command is executed, restored on the context by gl::Submit
+    std::optional<int> BoundProgram() const { return m_program; }
+    std::optional<int> BoundBuffer() const { return m_buffer; }
+    std::optional<int> BoundInstanceBuffer() const { return m_instanceBuffer; }
+    std::optional<int> BoundElementBuffer() const { return m_elementBuffer; }
+
+  private:
+    void RecordIndices(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount, DrawFunction function);
+    void RecordElements(RenderMode mode, size_t count, size_t offset, size_t instanceCount, DrawFunction function);
+    void Record(RenderMode mode, bool elements, size_t first, size_t count, size_t instanceCount, DrawFunction function);
+
+    template<class T>
+    static void Upload(Program &program, int location, const byte_t *value)
+    {
+      return program.UploadUniform<T>(location, *reinterpret_cast<const T *>(value));
+    }
+
+    template<class Vertex, class VertexShader>
+    static void TypedDraw(RenderMode mode, size_t count, const int *indices, size_t offset, size_t instanceCount)
+    {
+      if (indices)
+        return Pipeline::Draw<Vertex, VertexShader>(mode, instanceCount, { INT, indices, count });
+
+      std::optional<Pipeline::DrawIndices> elements = Pipeline::BoundElementIndices(count, offset);
+      if (!elements.has_value())
+        return;
+
+      return Pipeline::Draw<Vertex, VertexShader>(mode, instanceCount, elements.value());
+    }
+
+  private:
+    std::optional<int> m_program;
+    std::optional<int> m_buffer;
+    std::optional<int> m_instanceBuffer;
+    std::optional<int> m_elementBuffer;
+
+    std::vector<DrawCommand> m_draws;
+    std::vector<int> m_indices;
+
+    std::vector<UniformCommand> m_uniforms;
+    std::vector<byte_t> m_uniformData;
+    std::map<int, size_t> m_uploads; // number of uniforms uploaded to each program
+  };
+
+  // Executes the recorded commands, the compatible draws that follow each other are merged.
+  // With `reorder` the draws are sorted by program and buffers first (the order is only kept between two uniform
+  // uploads to their program) so more of them are merged: the primitives of different draws no longer overlap in
+  // recording order, only pass it when the depth test resolves the overlaps
+  void Submit(const CommandList &commands, bool reorder = false);
+}
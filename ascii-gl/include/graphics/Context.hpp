@@ -1,13 +1,20 @@
 #pragma once
 
 #include "graphics/primitives/Primitives.hpp"
+#include "graphics/primitives/TileBuffer.hpp"
+#include "graphics/primitives/VertexCache.hpp"
 #include "graphics/FrameBuffer.hpp"
 #include "graphics/Buffer.hpp"
+#include "graphics/ElementBuffer.hpp"
 #include "graphics/Shader.hpp"
+#include "graphics/Capabilities.hpp"
+
+#include "core/Core.hpp"
+#include "core/ThreadPool.hpp"
+#include "core/SlotMap.hpp"
 
 #include <glm/vec4.hpp>
 
-#include <map>
 #include <optional>
 
 class Context
@@ -20,24 +27,66 @@ public:
 
   std::optional<Buffer*> GetBuffer(int bufferId);
   std::optional<Buffer*> GetBoundBuffer();
+  std::optional<Buffer*> GetBoundInstanceBuffer();
+
+  std::optional<ElementBuffer*> GetElementBuffer(int bufferId);
+  std::optional<ElementBuffer*> GetBoundElementBuffer();
 
   std::vector<glm::vec4> &GetGeometryBuffer(size_t vertexCount);
   std::vector<glm::vec4> &GetGeometryBuffer() { return m_geometryBuffer; }
   const std::vector<glm::vec4> &GetGeometryBuffer() const { return m_geometryBuffer; }
 
+  // flag of every vertex of the geometry buffer, set if the vertex stage already moved it to screen space
+  std::vector<uint8_t> &GetProjectedVertices(size_t vertexCount);
+  std::vector<uint8_t> &GetProjectedVertices() { return m_projectedVertices; }
+
+  // varyings of every vertex of the geometry buffer, `varyingCount` floats per vertex
+  std::vector<float> &GetVaryingBuffer(size_t vertexCount, size_t varyingCount);
+  std::vector<float> &GetVaryingBuffer() { return m_varyingBuffer; }
+  const std::vector<float> &GetVaryingBuffer() const { return m_varyingBuffer; }
+  size_t GetVaryingCount() const { return m_varyingCount; }
+
+  // primitives assembled once for all the instances of an instanced draw call
+  PrimitiveBuffer &GetAssembledPrimitiveBuffer() { return m_assembledPrimitives; }
+
   PrimitiveBuffer &GetPrimitiveBuffer() { return m_primitives; }
   const PrimitiveBuffer &GetPrimitiveBuffer() const { return m_primitives; }
 
+  // destination and scratch buffers of the primitive compaction passes
+  PrimitiveBuffer &GetPrimitiveOutputBuffer() { return m_primitivesOutput; }
+  std::vector<uint32_t> &GetPrimitiveCounts() { return m_primitiveCounts; }
+  std::vector<uint32_t> &GetPrimitiveOffsets() { return m_primitiveOffsets; }
+  std::vector<uint32_t> &GetPrimitiveBlockSums() { return m_primitiveBlockSums; }
+
+  VertexCache &GetVertexCache() { return m_vertexCache; }
+  // indices of the chunks of the streamed draws that aren't a plain sub range of the draw's indices (see Pipeline::FetchChunk)
+  std::vector<uint32_t> &GetChunkIndices() { return m_chunkIndices; }
+  std::vector<VertexBatch> &GetVertexBatches() { return m_vertexBatches; }
+
+  // runs the parallel stages of the pipeline
+  ThreadPool &GetThreadPool() { return m_threadPool; }
+
+  TileBuffer &GetTileBuffer() { return m_tiles; }
+  const TileBuffer &GetTileBuffer() const { return m_tiles; }
+
   void SetFrameBuffer(FrameBuffer &framebuffer) { m_framebuffer = &framebuffer; }
   FrameBuffer &GetFrameBuffer() { return *m_framebuffer; }
 
+  // the created ids are only reserved, the objects are constructed when they're bound (or used for the programs),
+  // deleted ids are recreated the same way. Like any id that was never created, see SlotMap::Emplace
   bool IsBuffer(int bufferId) const;
-  int CreateBuffer(int minBufferId) const;
+  int CreateBuffer();
   void DeleteBuffer(int bufferId);
   void BindBuffer(int bufferId);
+  void BindInstanceBuffer(int bufferId);
+
+  bool IsElementBuffer(int bufferId) const;
+  int CreateElementBuffer();
+  void DeleteElementBuffer(int bufferId);
+  void BindElementBuffer(int bufferId);
 
   bool IsProgram(int programId) const;
-  int CreateProgram() const;
+  int CreateProgram();
   void DeleteProgram(int programId);
   void UseProgram(int programId);
 
@@ -45,30 +94,86 @@ public:
     requires IsVertex<Vertex>
   void BufferData(size_t size, const Vertex *vertices);
 
+  template<class Index>
+    requires IsIndex<Index>
+  void ElementData(size_t size, const Index *indices);
+
   void SetViewport(float x, float y, float width, float height);
   glm::vec4 GetViewport() const { return m_viewport; }
 
+  void Enable(gl::Capability capability) { m_capabilities |= BIT(int(capability)); }
+  void Disable(gl::Capability capability) { m_capabilities &= ~BIT(int(capability)); }
+  bool IsEnabled(gl::Capability capability) const { return m_capabilities & BIT(int(capability)); }
+
+  void SetCullFace(gl::Face face) { m_cullFace = face; }
+  gl::Face GetCullFace() const { return m_cullFace; }
+
+  void SetFrontFace(gl::Winding winding) { m_frontFace = winding; }
+  gl::Winding GetFrontFace() const { return m_frontFace; }
+
+  void SetClearDepth(float depth) { m_clearDepth = depth; }
+  float GetClearDepth() const { return m_clearDepth; }
+
+  void SetGeometryBudget(size_t bytes) { m_geometryBudget = bytes; }
+  size_t GetGeometryBudget() const { return m_geometryBudget; }
+
 private:
   static Scope<Context> m_instance;
 
 private:
   int m_bound_buffer = 0;
+  int m_bound_instance_buffer = 0;
   int m_bound_program = 0;
-  std::map<int, Buffer> m_vertexBuffers; // VAO array
-  std::map<int, Program> m_programs;
+  SlotMap<Buffer> m_vertexBuffers; // VAO array
+  int m_bound_element_buffer = 0;
+  SlotMap<ElementBuffer> m_elementBuffers;
+  SlotMap<Program> m_programs;
   FrameBuffer *m_framebuffer;
 
+#ifdef SINGLE_THREADED
+  ThreadPool m_threadPool{ 1 };
+#else
+  ThreadPool m_threadPool;
+#endif
+
+  PrimitiveBuffer m_assembledPrimitives;
   PrimitiveBuffer m_primitives;
+  PrimitiveBuffer m_primitivesOutput;
+  std::vector<uint32_t> m_primitiveCounts;
+  std::vector<uint32_t> m_primitiveOffsets;
+  std::vector<uint32_t> m_primitiveBlockSums;
+  TileBuffer m_tiles;
+  VertexCache m_vertexCache;
+  std::vector<uint32_t> m_chunkIndices;
+  std::vector<VertexBatch> m_vertexBatches;
   std::vector<glm::vec4> m_geometryBuffer;
+  std::vector<uint8_t> m_projectedVertices;
+  std::vector<float> m_varyingBuffer;
+  size_t m_varyingCount = 0;
 
   glm::vec4 m_viewport = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+  uint32_t m_capabilities = 0;
+  gl::Face m_cullFace = gl::BACK;
+  gl::Winding m_frontFace = gl::CCW;
+
+  float m_clearDepth = 1.0f;
+
+  size_t m_geometryBudget = 64 * 1024 * 1024;
 };
 
 template<class Vertex>
   requires IsVertex<Vertex>
 void Context::BufferData(size_t size, const Vertex *data)
 {
-  if (!m_bound_buffer)
-    return;
-  m_vertexBuffers[m_bound_buffer].Set(size, data);
+  if (Buffer *buffer = m_vertexBuffers.Get(m_bound_buffer))
+    buffer->Set(size, data);
+}
+
+template<class Index>
+  requires IsIndex<Index>
+void Context::ElementData(size_t size, const Index *indices)
+{
+  if (ElementBuffer *buffer = m_elementBuffers.Get(m_bound_element_buffer))
+    buffer->Set(size, indices);
 }
\ No newline at end of file
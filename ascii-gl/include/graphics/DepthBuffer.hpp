@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/types.h"
+#include "graphics/primitives/TileBuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Per pixel depth storage with a coarse (one level) hierarchy:
+// every tile of TileBuffer::TILE_SIZE pixels keeps the min and max depth of its pixels,
+// so whole triangles or tiles can be rejected without reading the pixels themselves.
+class DepthBuffer
+{
+public:
+  static constexpr unsigned int TILE_SIZE = TileBuffer::TILE_SIZE;
+
+  struct Tile
+  {
+    float min; // closest depth stored in the tile
+    float max; // farthest depth stored in the tile
+  };
+
+public:
+  // Reallocate the buffer if its size changed, the content is then reset to the last clear value
+  void Resize(unsigned int width, unsigned int height);
+
+  void Clear(float depth = 1.0f);
+
+  // true as long as the buffer was never allocated
+  bool Empty() const { return m_depth.empty(); }
+
+  unsigned int Width() const { return m_width; }
+  unsigned int Height() const { return m_height; }
+
+  // rows are padded to an even number of pixels (as is the number of rows)
+  // so a whole 2x2 quad can always be loaded
+  float *Row(unsigned int y) { return m_depth.data() + size_t(y) * m_pitch; }
+  const float *Row(unsigned int y) const { return m_depth.data() + size_t(y) * m_pitch; }
+
+  // returns the tile containing the given pixel
+  Tile &GetTile(glm::ivec2 pixel) { return m_tiles[(pixel.y / TILE_SIZE) * m_tileWidth + (pixel.x / TILE_SIZE)]; }
+  const Tile &GetTile(glm::ivec2 pixel) const { return m_tiles[(pixel.y / TILE_SIZE) * m_tileWidth + (pixel.x / TILE_SIZE)]; }
+
+  // true if no pixel in the given bounds (inclusive) can be closer than depth
+  bool Occluded(glm::ivec2 min, glm::ivec2 max, float depth) const;
+
+  // recomputes the min / max depth of the tile whose pixels are in the given bounds (inclusive)
+  void UpdateTile(glm::ivec2 min, glm::ivec2 max);
+
+private:
+  unsigned int m_width = 0;
+  unsigned int m_height = 0;
+  unsigned int m_pitch = 0;
+
+  unsigned int m_tileWidth = 0;
+
+  float m_clearDepth = 1.0f;
+
+  std::vector<float> m_depth;
+  std::vector<Tile> m_tiles;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/types.h"
+#include "graphics/VertexLayout.hpp"
+
+#include <concepts>
+#include <vector>
+
+template<class T>
+concept IsIndex = std::same_as<T, uint16_t> || std::same_as<T, uint32_t>;
+
+// Indices uploaded once and referenced by the draw calls with an offset and a count (see gl::DrawElementBuffer)
+struct ElementBuffer
+{
+public:
+  void Clear()
+  {
+    m_shortIndices.clear();
+    m_intIndices.clear();
+
+    m_mappedIndices = nullptr;
+    m_mappedCount = 0;
+    m_mapping.reset();
+  }
+
+  // UNSIGNED_SHORT or UNSIGNED_INT
+  gl::AttribType Type() const { return m_type; }
+  size_t Count() const
+  {
+    if (m_mapping)
+      return m_mappedCount;
+    return m_type == gl::UNSIGNED_SHORT ? m_shortIndices.size() : m_intIndices.size();
+  }
+
+  template<class Index>
+    requires IsIndex<Index>
+  void Set(size_t count, const Index *indices)
+  {
+    Clear();
+    if constexpr (std::same_as<Index, uint16_t>)
+    {
+      m_type = gl::UNSIGNED_SHORT;
+      m_shortIndices.assign(indices, indices + count);
+    }
+    else
+    {
+      m_type = gl::UNSIGNED_INT;
+      m_intIndices.assign(indices, indices + count);
+    }
+  }
+
+  // Uses the indices stored at `indices` in place (no copy), `owner` keeps the memory alive as long as the buffer uses it
+  template<class Index>
+    requires IsIndex<Index>
+  void SetMapped(size_t count, const Index *indices, Ref<void> owner)
+  {
+    Clear();
+    m_type = std::same_as<Index, uint16_t> ? gl::UNSIGNED_SHORT : gl::UNSIGNED_INT;
+    m_mappedIndices = indices;
+    m_mappedCount = count;
+    m_mapping = std::move(owner);
+  }
+
+  bool IsMapped() const { return m_mapping != nullptr; }
+
+  // only valid if Index matches Type()
+  template<class Index>
+    requires IsIndex<Index>
+  const Index *Data(size_t offset = 0) const
+  {
+    if (m_mapping)
+      return static_cast<const Index *>(m_mappedIndices) + offset;
+    if constexpr (std::same_as<Index, uint16_t>)
+      return m_shortIndices.data() + offset;
+    else
+      return m_intIndices.data() + offset;
+  }
+
+private:
+  gl::AttribType m_type = gl::UNSIGNED_INT;
+  std::vector<uint16_t> m_shortIndices;
+  std::vector<uint32_t> m_intIndices;
+
+  // set instead of the vectors by SetMapped
+  const void *m_mappedIndices = nullptr;
+  size_t m_mappedCount = 0;
+  Ref<void> m_mapping;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "core/types.h"
+#include "graphics/DepthBuffer.hpp"
+
 #include <glm/glm.hpp>
 
 class FrameBuffer
@@ -22,4 +24,25 @@ public:
   virtual void SetPixel(unsigned int x, unsigned int y, glm::vec3 color) = 0;
   virtual void SetPixel(unsigned int x, unsigned int y, glm::vec4 color) = 0;
   virtual void SetPixel(unsigned int x, unsigned int y, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 0xff) = 0;
+
+  // writes the same color on `length` consecutive pixels of the row y, starting at x
+  virtual void FillSpan(unsigned int x, unsigned int y, unsigned int length, uint32_t color)
+  {
+    for (unsigned int i = 0; i < length; ++i)
+      SetPixel(x + i, y, color);
+  }
+
+  // writes `length` consecutive pixels of the row y, starting at x, with their own color
+  virtual void WriteSpan(unsigned int x, unsigned int y, unsigned int length, const uint32_t *colors)
+  {
+    for (unsigned int i = 0; i < length; ++i)
+      SetPixel(x + i, y, colors[i]);
+  }
+
+  // optional depth attachment, only allocated once the depth test is used
+  DepthBuffer &GetDepthBuffer() { return m_depth; }
+  const DepthBuffer &GetDepthBuffer() const { return m_depth; }
+
+protected:
+  DepthBuffer m_depth;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <concepts>
+#include <type_traits>
 
 struct IVertex
 {
@@ -8,5 +9,6 @@ struct IVertex
   // common vertex code here
 };
 
+// vertices either inherit IVertex or are plain data described by a VertexLayout
 template<class Vertex>
-concept IsVertex = std::is_base_of<IVertex, Vertex>::value;
+concept IsVertex = std::is_base_of<IVertex, Vertex>::value || std::is_trivially_copyable<Vertex>::value;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "core/types.h"
+#include "graphics/VertexLayout.hpp"
+
+#include <string>
+#include <memory>
+
+class MappedFile;
+struct Buffer;
+struct ElementBuffer;
+
+// Vertices and indices stored on disk exactly as they are drawn (.aglm files).
+// The file is mapped in memory and the buffers use its pages in place, nothing is parsed nor copied when it's loaded.
+// Every section starts on a 16 bytes boundary, the values are stored in the byte order of the machine that wrote them
+class MeshFile : public std::enable_shared_from_this<MeshFile>
+{
+public:
+  static constexpr uint32_t MAGIC = 0x4D4C4741; // "AGLM"
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t ALIGNMENT = 16;
+
+  struct Attribute
+  {
+    uint32_t offset;
+    uint8_t enabled;
+    uint8_t count;
+    uint8_t type; // gl::AttribType
+    uint8_t normalized;
+  };
+
+  struct Header
+  {
+    uint32_t magic;
+    uint32_t version;
+
+    uint64_t vertexCount;
+    uint64_t vertexOffset; // in bytes, from the start of the file
+    uint32_t vertexSize;
+
+    uint32_t indexSize; // 2 (uint16_t), 4 (uint32_t) or 0 if the mesh has no indices
+    uint64_t indexCount;
+    uint64_t indexOffset;
+
+    Attribute attributes[MAX_VERTEX_ATTRIBS];
+  };
+
+public:
+  // returns nullptr if the file can't be mapped or isn't a valid mesh file
+  static Ref<MeshFile> Open(const std::string &path);
+
+  // Writes the vertices, their layout and the indices (if any) as a mesh file, returns false on failure.
+  // The vertices must be plain data, the ones inheriting IVertex can't be stored
+  static bool Write(const std::string &path, size_t vertexSize, size_t vertexCount, const void *vertices, const VertexLayout &layout,
+                    size_t indexSize = 0, size_t indexCount = 0, const void *indices = nullptr);
+  static bool Write(const std::string &path, const Buffer &vertices, const ElementBuffer *indices = nullptr);
+
+  ~MeshFile();
+
+  size_t VertexSize() const { return m_header->vertexSize; }
+  size_t VertexCount() const { return m_header->vertexCount; }
+  byte_t *Vertices() const;
+  VertexLayout Layout() const;
+
+  bool HasIndices() const { return m_header->indexSize != 0 && m_header->indexCount != 0; }
+  size_t IndexCount() const { return m_header->indexCount; }
+  gl::AttribType IndexType() const { return m_header->indexSize == sizeof(uint16_t) ? gl::UNSIGNED_SHORT : gl::UNSIGNED_INT; }
+  const void *Indices() const;
+
+  // the buffers reference the mapped file, which stays open as long as one of them uses it
+  void MapVertices(Buffer &buffer);
+  void MapIndices(ElementBuffer &buffer);
+
+private:
+  MeshFile(Scope<MappedFile> file);
+
+private:
+  Scope<MappedFile> m_file;
+  const Header *m_header;
+};
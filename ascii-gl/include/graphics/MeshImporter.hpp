@@ -0,0 +1,48 @@
+#pragma once
+
+#include "core/types.h"
+#include "graphics/VertexLayout.hpp"
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+class ThreadPool;
+
+// Plain data vertex of the imported meshes, the missing attributes are left to 0
+struct MeshVertex
+{
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec2 texCoord;
+
+  // position (0), normal (1) and texture coordinates (2), as given to gl::VertexAttribPointer
+  static VertexLayout Layout();
+};
+
+// Interleaved vertices and triangle list indices, ready for gl::BufferData and gl::ElementData
+struct MeshData
+{
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+
+  bool hasNormals = false;
+  bool hasTexCoords = false;
+};
+
+// Imports the triangles of Wavefront OBJ and binary PLY files.
+// The files are mapped and parsed in parallel on the given thread pool: the OBJ files are split in chunks of
+// whole lines, counted then parsed, and their position/texture/normal index triplets are deduplicated in hash tables
+// (one per shard of the hash space). The polygons are triangulated as fans
+class MeshImporter
+{
+public:
+  // picks the format from the extension (.obj or .ply), returns nullopt if the file can't be read or is invalid
+  static std::optional<MeshData> Import(const std::string &path, ThreadPool &pool);
+
+  static std::optional<MeshData> ImportObj(const std::string &path, ThreadPool &pool);
+  static std::optional<MeshData> ImportPly(const std::string &path, ThreadPool &pool);
+};
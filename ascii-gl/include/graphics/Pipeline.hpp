@@ -0,0 +1,229 @@
+#pragma once
+
+#include "core/Log.hpp"
+
+#include "graphics/gl.hpp"
+#include "graphics/Context.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <optional>
+
+// Stages of a draw call, shared by the generic draw calls and the typed ones below
+namespace Pipeline
+{
+  // Number of vertices given to each call of the vertex shader
+  constexpr size_t VERTEX_BATCH_SIZE = 256;
+
+  // Smallest chunk a draw call is split into, whatever the geometry budget
+  constexpr size_t MIN_CHUNK_SIZE = 3 * VERTEX_BATCH_SIZE;
+
+  // Indices of a draw call: the client side ones (INT) or a range of an element buffer (UNSIGNED_SHORT or UNSIGNED_INT)
+  struct DrawIndices
+  {
+    gl::AttribType type;
+    const void *data;
+    size_t count;
+  };
+
+  // Indices [offset, offset + count) of the bound element buffer, nullopt if there is none or the range is invalid
+  std::optional<DrawIndices> BoundElementIndices(size_t count, size_t offset);
+
+  // Builds the list of the vertices referenced by the indices, returns false if an index is invalid
+  bool FetchVertices(const Buffer &vertices, const DrawIndices &indices);
+
+  // Draw calls are streamed through the pipeline in chunks of indices so their transient buffers (geometry, varyings,
+  // primitives) stay within the geometry budget of the context. Chunks of connected primitives overlap
+  size_t ChunkSize(gl::RenderMode mode, size_t varyingCount);
+  size_t ChunkCount(gl::RenderMode mode, size_t indicesCount, size_t chunkSize);
+
+  // Checks every index of the draw call before any chunk is drawn, an invalid one would leave the draw half done
+  bool CheckIndices(const Buffer &vertices, const DrawIndices &indices);
+
+  // Fetches the vertices of a chunk of the draw call, returns the mode to draw it with (nullopt if an index is invalid)
+  std::optional<gl::RenderMode> FetchChunk(const Buffer &vertices, gl::RenderMode mode, const DrawIndices &indices, size_t chunk, size_t chunkSize);
+
+  // Allocates the geometry and varying buffers of the fetched vertices and splits them into batches
+  std::vector<VertexBatch> &PrepareBatches(const Buffer &vertices, size_t varyingCount, size_t instance = 0, const Buffer *instances = nullptr);
+
+  // Moves the vertices of the batch that are inside of the clipping volume to screen space, right after they are shaded
+  // (while they are still in cache). The other ones are left in clip space for the clipping, which projects them afterward
+  void ProjectVertices(const VertexBatch &batch);
+
+  // Everything that follows the vertex shader: assembly, clipping, viewport transform, culling and rasterization.
+  // The primitives are only assembled for the first instance, the other ones reuse them
+  void DrawPrimitives(gl::RenderMode mode, size_t instance = 0, size_t instanceCount = 1);
+
+  // Skeleton of every draw call: the indices are streamed through the pipeline in chunks, the vertices of every chunk
+  // are shaded by `stage` then drawn. The vertex stage provides Begin(), BeginInstance(instance, instances)
+  // and operator()(const VertexBatch &), the latter is called on the worker threads.
+  // The instances are drawn one after the other, each of them whole, so they keep their order: a draw that fits
+  // in one chunk fetches it (and assembles its primitives) once for all the instances, the others fetch their
+  // chunks again for every instance
+  template<class VertexStage>
+  void Execute(Buffer &buffer, gl::RenderMode mode, size_t instanceCount, const DrawIndices &indices, size_t varyingCount, const VertexStage &stage)
+  {
+    Context &context = *Context::Instance();
+
+    buffer.UpdateStreams();
+
+    const Buffer *instances = context.GetBoundInstanceBuffer().value_or(nullptr);
+
+    const size_t chunkSize = ChunkSize(mode, varyingCount);
+    const size_t chunkCount = ChunkCount(mode, indices.count, chunkSize);
+
+    const bool chunked = chunkCount > 1;
+    if (chunked && !CheckIndices(buffer, indices))
+      return;
+
+    std::optional<gl::RenderMode> chunkMode = chunked ? std::optional(mode) : FetchChunk(buffer, mode, indices, 0, chunkSize);
+    if (!chunkMode.has_value())
+      return;
+
+    stage.Begin();
+    for (size_t instance = 0; instance < instanceCount; ++instance)
+    {
+      stage.BeginInstance(instance, instances);
+
+      for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+      {
+        if (chunked)
+        {
+          chunkMode = FetchChunk(buffer, mode, indices, chunk, chunkSize);
+          if (!chunkMode.has_value())
+            return;
+        }
+
+        // Vertex shader
+        {
+          std::vector<VertexBatch> &batches = PrepareBatches(buffer, varyingCount, instance, instances);
+
+          // a batch is big enough to be a chunk of its own
+          context.GetThreadPool().ForEach(batches.begin(), batches.end(), [&stage](const VertexBatch &batch) {
+            stage(batch);
+            ProjectVertices(batch);
+          }, 1);
+        }
+
+        // the primitives of the chunks are assembled again for every instance
+        if (chunked)
+          DrawPrimitives(chunkMode.value());
+        else
+          DrawPrimitives(chunkMode.value(), instance, instanceCount);
+      }
+    }
+  }
+
+  // Vertex stage of the typed draw calls below.
+  // The shader is called directly (no virtual call, no IVertex) so it can be inlined, a shader overriding the batch
+  // operator is given the whole batches instead
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  struct TypedVertexStage
+  {
+    VertexShader &shader;
+
+    // qualified calls are never virtual
+    void Begin() const { shader.VertexShader::Begin(); }
+    void BeginInstance(size_t instance, const Buffer *instances) const { shader.VertexShader::BeginInstance(instance, instances); }
+
+    void operator()(const VertexBatch &batch) const
+    {
+      if constexpr (OverridesOperator<VertexShader, void(const VertexBatch &) const>)
+        return shader.VertexShader::operator()(batch);
+
+      const size_t varyingCount = shader.VaryingCount();
+
+      for (size_t i = 0; i < batch.count; ++i)
+      {
+        const Vertex &vertex = batch.Get<Vertex>(i);
+        const size_t idx = batch.indices[i];
+
+        if constexpr (requires (const VertexShader &s, const Vertex &v, float *varyings) { s(v, size_t(0), varyings); })
+        {
+          if (varyingCount)
+          {
+            batch.positions[i] = shader.VertexShader::operator()(vertex, idx, batch.varyings + i * varyingCount);
+            continue;
+          }
+        }
+        batch.positions[i] = shader.VertexShader::operator()(vertex, idx);
+      }
+    }
+  };
+
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void Draw(gl::RenderMode mode, size_t instanceCount, const DrawIndices &indices)
+  {
+    std::optional<Buffer *> buffer;
+    std::optional<Program *> program;
+
+    Context &context = *Context::Instance();
+    buffer = context.GetBoundBuffer();
+    program = context.GetBoundProgram();
+
+    if (!buffer.has_value() || !program.has_value())
+      return;
+
+    // checked once per draw call, the buffer only knows the size of its vertices (not their type)
+    VertexShader *shader = dynamic_cast<VertexShader *>(&program.value()->GetVertexShader());
+    if (!shader || buffer.value()->Size() != sizeof(Vertex))
+    {
+      LOG_ERROR("DrawElements: the bound program doesn't use the requested vertex shader or the vertices of the bound buffer aren't {} bytes", sizeof(Vertex));
+      return;
+    }
+
+    return Execute(*buffer.value(), mode, instanceCount, indices, shader->VaryingCount(), TypedVertexStage<Vertex, VertexShader>{ *shader });
+  }
+}
+
+namespace gl
+{
+  // Same as DrawElements, but the vertex stage is instantiated for the given vertex and shader types.
+  // The bound program must use a VertexShader and the bound buffer must hold Vertex
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void DrawElements(RenderMode mode, size_t indicesCount, const int *indices)
+  {
+    return Pipeline::Draw<Vertex, VertexShader>(mode, 1, { INT, indices, indicesCount });
+  }
+
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void DrawElements(RenderMode mode, const std::vector<int> &indices)
+  {
+    return DrawElements<Vertex, VertexShader>(mode, indices.size(), indices.data());
+  }
+
+  // Same as DrawElementBuffer, with the typed vertex stage of DrawElements<Vertex, VertexShader>
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void DrawElementBuffer(RenderMode mode, size_t count, size_t offset = 0)
+  {
+    std::optional<Pipeline::DrawIndices> indices = Pipeline::BoundElementIndices(count, offset);
+    if (!indices.has_value())
+      return;
+
+    return Pipeline::Draw<Vertex, VertexShader>(mode, 1, indices.value());
+  }
+
+  // Same as DrawElementsInstanced, with the typed vertex stage of DrawElements<Vertex, VertexShader>
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount)
+  {
+    return Pipeline::Draw<Vertex, VertexShader>(mode, instanceCount, { INT, indices.data(), indices.size() });
+  }
+
+  template<class Vertex, class VertexShader>
+    requires IsVertex<Vertex> && IsVertexShaderFor<VertexShader, Vertex>
+  void DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount)
+  {
+    std::optional<Pipeline::DrawIndices> indices = Pipeline::BoundElementIndices(count, offset);
+    if (!indices.has_value())
+      return;
+
+    return Pipeline::Draw<Vertex, VertexShader>(mode, instanceCount, indices.value());
+  }
+}
@@ -1,18 +1,80 @@
 #pragma once
 
+#include "core/Core.hpp"
 #include "core/types.h"
 
 #include "graphics/IVertex.hpp"
+#include "graphics/Buffer.hpp"
+#include "graphics/VertexLayout.hpp"
 
+#include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include <map>
+#include <vector>
+#include <string>
+#include <cstring>
 #include <stdexcept>
 #include <string_view>
+#include <type_traits>
 
 class IVertexShader;
 class IFragmentShader;
 
+// Maximum number of floats a vertex shader can pass to the fragment shader
+constexpr size_t MAX_VARYINGS = 16;
+
+// Kinds of vertices a vertex shader reads, known from the operators it overrides (see VertexShaderInputs)
+enum class VertexInput : uint8_t
+{
+  IVERTEX    = BIT(0), // vertices inheriting IVertex
+  ATTRIBUTES = BIT(1)  // plain data vertices described by the layout of their buffer
+};
+
+// A batch of vertices to shade: the vertex i of the batch is `buffer->Vertex(indices[i])`,
+// its position goes to positions[i] and its varyings to varyings + i * VaryingCount()
+struct VertexBatch
+{
+  const Buffer *buffer;
+  const unsigned int *indices;
+  size_t count;
+
+  glm::vec4 *positions;
+  float *varyings;
+
+  // instance being drawn and bound instance buffer (nullptr if none), see IVertexShader::BeginInstance
+  size_t instance = 0;
+  const Buffer *instances = nullptr;
+
+  // indices are consecutive (indices[i] == indices[0] + i): with a STRUCTURE_OF_ARRAYS buffer,
+  // the components of the batch can be loaded straight from `buffer->Streams().Stream(a, c) + indices[0]`
+  bool contiguous = false;
+
+  // Writes `matrix * attribute` of every vertex of the batch to its position. Contiguous batches of STRUCTURE_OF_ARRAYS
+  // buffers are transformed 4 vertices at a time from the streams, the other ones are fetched vertex by vertex
+  void Transform(unsigned int attribute, const glm::mat4 &matrix) const;
+
+  template<class Vertex>
+    requires IsVertex<Vertex>
+  const Vertex &Get(size_t i) const { return buffer->Get<Vertex>(indices[i]); }
+};
+
+// Input of the fragment shader: a 2x2 block of pixels, the lanes are ordered as follow
+//   lane 0: (x, y)     lane 1: (x + 1, y)
+//   lane 2: (x, y + 1) lane 3: (x + 1, y + 1)
+// lanes outside of the primitive are still interpolated (extrapolated really) but their color is discarded
+struct FragmentQuad
+{
+  glm::ivec2 position; // top left pixel of the quad
+  int coverage;        // bit i is set if the lane i is drawn
+
+  alignas(16) float depth[4];
+  alignas(16) float varyings[MAX_VARYINGS][4]; // varyings[v][lane], perspective correct
+
+  bool Covered(int lane) const { return coverage & (1 << lane); }
+};
+
 class InvalidUniformException : public std::runtime_error
 {
 public:
@@ -20,107 +82,115 @@ public:
   InvalidUniformException(const std::string_view error, const std::string_view name) : std::runtime_error(std::string(error) + ": " + std::string(name)) {}
 };
 
-
-class Program
+class InvalidShaderException : public std::runtime_error
 {
-  template<class T>
-  class Uniform;
-
-  struct IUniform
-  {
-    IUniform(size_t size) : size(size) {}
-    virtual ~IUniform() = default;
+public:
+  InvalidShaderException(const std::string_view error) : std::runtime_error("Invalid shader: " + std::string(error)) {}
+};
 
-    size_t size;
 
-    template<class T>
-    Uniform<T> *Cast() { return dynamic_cast<Uniform<T>*>(this); }
-    template<class T>
-    const Uniform<T> *Cast() const { return dynamic_cast<Uniform<T>*>(this); }
+// Unique address per type, used to check the type of the uniforms without RTTI
+template<class T>
+inline constexpr char TYPE_TAG = 0;
 
-    template<class T> Uniform<T> &As() { return *Cast<T>(); }
-    template<class T> const Uniform<T> &As() const { return *Cast<T>(); }
+class Program
+{
+  // the uniform storage is made of 16 bytes aligned blocks
+  struct alignas(16) UniformBlock
+  {
+    byte_t data[16];
   };
 
-  template<class T>
-  class Uniform : public IUniform
+  struct UniformSlot
   {
-  public:
-    Uniform(const T &value) : IUniform{ sizeof(T) }, m_value(value) {}
-    Uniform(T &&value) : IUniform{ sizeof(T) }, m_value(std::move(value)) {}
-    virtual ~Uniform() = default;
-
-    void Set(const T &value) { m_value = value; }
-    void Set(T &&value) { m_value = std::move(value); }
-
-    const T &Get() { return m_value; }
-    const T &Get() const { return m_value; }
-
-  private:
-    T m_value;
+    std::string name;
+    const void *type = nullptr; // &TYPE_TAG<T> of the stored value, nullptr until the first upload
+    size_t offset = 0;          // in bytes, in the uniform storage
+    size_t capacity = 0;        // bytes allocated at offset, reused when the type changes
   };
 
 public:
-  void Attach(IVertexShader *vertexShader);
+  // `inputs` is the VertexInput mask of the shader (see VertexShaderInputs)
+  void Attach(IVertexShader *vertexShader, uint8_t inputs);
   void Attach(IFragmentShader *fragmentShader);
   bool IsValid();
 
   IVertexShader &GetVertexShader() { return *m_vertexShader; }
+  // nullptr if no fragment shader was attached
+  const IFragmentShader *GetFragmentShader() const { return m_fragmentShader.get(); }
+
+  // Returns the location of a uniform, unknown uniforms are declared on the fly
+  // so the shaders can resolve their uniforms once, before anything is uploaded
+  int GetUniformLocation(const std::string_view name);
 
   template<class T>
-  void UploadUniform(const std::string_view name, const T &value)
+    requires std::is_trivially_copyable_v<T>
+  void UploadUniform(int location, const T &value)
   {
-    using U = std::remove_cvref_t<T>;
-    Uniform<U> *uniform = m_uniforms[name]->Cast<U>();
+    UniformSlot &slot = GetSlot(location);
 
-    if (!uniform)
-    {
-      m_uniforms[name].reset(new Uniform<U>(value));
-      return;
-    }
-    else
+    // a type change keeps the offset of the uniform when the new type fits
+    if (slot.type != &TYPE_TAG<T>)
     {
-      uniform->Set(value);
+      if (sizeof(T) > slot.capacity)
+        Allocate(slot, sizeof(T));
+      slot.type = &TYPE_TAG<T>;
     }
+    std::memcpy(Storage(slot.offset), &value, sizeof(T));
+  }
+
+  template<class T>
+    requires std::is_trivially_copyable_v<T>
+  void UploadUniform(const std::string_view name, const T &value)
+  {
+    return UploadUniform<T>(GetUniformLocation(name), value);
   }
 
+  // The reference points into the uniform storage of the program, it's invalidated when the storage grows:
+  // on the first upload of a uniform or when one is uploaded with a larger type. The shaders read their uniforms
+  // during the draw calls, when nothing is uploaded
   template<class T>
-  void UploadUniform(const std::string_view name, T &&value)
+  const T &GetUniform(int location) const
   {
     using U = std::remove_cvref_t<T>;
-    Uniform<U> *uniform = m_uniforms[name]->Cast<U>();
+    const UniformSlot &slot = GetSlot(location);
 
-    if (!uniform)
-    {
-      m_uniforms[name].reset(new Uniform<U>(std::forward<U>(value)));
-      return;
-    }
-    else
-    {
-      uniform->Set(std::forward<U>(value));
-    }
+    if (slot.type != &TYPE_TAG<U>)
+      throw InvalidUniformException(slot.name);
+
+    return *reinterpret_cast<const U *>(Storage(slot.offset));
   }
 
   template<class T>
   const T &GetUniform(const std::string_view name) const
   {
-    using U = std::remove_cvref_t<T>;
-
-    std::map<std::string_view, Scope<IUniform>>::const_iterator it;
+    std::map<std::string, int, std::less<>>::const_iterator it;
 
-    it = m_uniforms.find(name);
-    if (it == m_uniforms.end() || !it->second->Cast<U>())
+    it = m_locations.find(name);
+    if (it == m_locations.end())
       throw InvalidUniformException(name);
 
-    return it->second->As<U>().Get();
+    return GetUniform<T>(it->second);
   }
 
+private:
+  UniformSlot &GetSlot(int location);
+  const UniformSlot &GetSlot(int location) const;
+
+  // moves the uniform to `size` new bytes (rounded to whole blocks) at the end of the uniform storage
+  void Allocate(UniformSlot &slot, size_t size);
+
+  byte_t *Storage(size_t offset) { return m_storage.front().data + offset; }
+  const byte_t *Storage(size_t offset) const { return m_storage.front().data + offset; }
+
 private:
   friend class IShader;
   friend class IVertexShader;
   friend class IFragmentShader;
 
-  std::map<std::string_view, Scope<IUniform>> m_uniforms;
+  std::map<std::string, int, std::less<>> m_locations;
+  std::vector<UniformSlot> m_uniforms;
+  std::vector<UniformBlock> m_storage;
 
   Scope<IVertexShader>   m_vertexShader;
   Scope<IFragmentShader> m_fragmentShader;
@@ -134,6 +204,25 @@ protected:
   virtual ~IShader() = default;
 
 protected:
+  // meant to be called once (in the constructor of the shader), the location is then given to Uniform
+  int UniformLocation(const std::string_view name) const
+  {
+    return m_parent.GetUniformLocation(name);
+  }
+
+  template<class T>
+  const T &Uniform(int location) const
+  {
+    try
+    {
+      return m_parent.GetUniform<std::remove_cvref_t<T>>(location);
+    }
+    catch (const InvalidUniformException &e)
+    {
+      throw InvalidUniformException("Missmatching uniform type in shader", e.what());
+    }
+  }
+
   template<class T>
   const T &Uniform(const std::string_view name) const
   {
@@ -148,16 +237,75 @@ protected:
   }
 
 private:
-  const Program &m_parent;
+  Program &m_parent;
 };
 
 
 class IVertexShader : public IShader
 {
 public:
-  IVertexShader(Program &parent) : IShader(parent) {}
+  // varyingCount is the number of floats written by the shader for the fragment shader,
+  // throws an InvalidShaderException if it's more than MAX_VARYINGS
+  IVertexShader(Program &parent, size_t varyingCount = 0);
+
+  // called once per draw call before any vertex is shaded,
+  // values that are constant for the whole draw (derived from the uniforms) can be computed and cached here
+  virtual void Begin() {}
+
+  // called before the vertices of every instance are shaded (instance 0 for the draw calls that aren't instanced),
+  // `instances` is the bound instance buffer (nullptr if none), the per instance data is read from it
+  virtual void BeginInstance(size_t /*instance*/, const Buffer * /*instances*/) {}
+
+  // A shader overrides the operators matching the vertices it's used with (at least one, see IsValidVertexShader):
+  // - one of the IVertex ones for vertices inheriting IVertex
+  // - the VertexAttributes one for plain data vertices described by the layout of their buffer
+  // - or the batch one for both
+  // The draw calls reading vertices the shader has no operator for are refused, the defaults are never called
+
+  virtual glm::vec4 operator()(const IVertex & /*vertex*/, size_t /*idx*/) const { return glm::vec4(0.0f); }
+
+  // `varyings` holds VaryingCount() floats (null if the shader has none), the default calls the one above
+  virtual glm::vec4 operator()(const IVertex &vertex, size_t idx, float * /*varyings*/) const { return operator()(vertex, idx); }
+
+  // `varyings` holds VaryingCount() floats (null if the shader has none)
+  virtual glm::vec4 operator()(const VertexAttributes & /*attributes*/, size_t /*idx*/, float * /*varyings*/) const { return glm::vec4(0.0f); }
 
-  virtual glm::vec4 operator()(const IVertex &vertex, size_t idx) const = 0;
+  // Entry point of the vertex stage, shades a whole batch at once.
+  // Override it to avoid a virtual call per vertex, the default implementation calls the per vertex operators
+  virtual void operator()(const VertexBatch &batch) const
+  {
+    // vertices described by a layout are read attribute by attribute
+    if (!batch.buffer->Layout().Empty())
+    {
+      VertexAttributes attributes;
+
+      for (size_t i = 0; i < batch.count; ++i)
+      {
+        const unsigned int idx = batch.indices[i];
+
+        batch.buffer->Fetch(idx, attributes);
+        batch.positions[i] = operator()(attributes, idx, m_varyingCount ? batch.varyings + i * m_varyingCount : nullptr);
+      }
+      return;
+    }
+
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+      const unsigned int idx = batch.indices[i];
+      batch.positions[i] = operator()(batch.buffer->Vertex(idx), idx, m_varyingCount ? batch.varyings + i * m_varyingCount : nullptr);
+    }
+  }
+
+  size_t VaryingCount() const { return m_varyingCount; }
+
+  // the shader has an operator for this kind of vertices
+  bool Reads(VertexInput input) const { return m_inputs & uint8_t(input); }
+
+private:
+  friend class Program;
+
+  const size_t m_varyingCount;
+  uint8_t m_inputs = 0; // VertexInput mask, set by Program::Attach
 };
 
 
@@ -165,24 +313,62 @@ class IFragmentShader : public IShader
 {
 public:
   IFragmentShader(Program &parent) : IShader(parent) {}
+
+  // writes the color of the 4 pixels of the quad
+  virtual void operator()(const FragmentQuad &quad, glm::vec4 (&colors)[4]) const = 0;
 };
 
 
 template<class VertexShader>
 concept IsVertexShader = std::is_base_of<IVertexShader, VertexShader>::value;
 
+// Class declaring the member function of the given signature, deduced from the overload set of `&Shader::operator()`
+// (only used in unevaluated contexts). The overloads of IVertexShader are found if the shader declares no operator()
+template<class Signature, class Shader>
+Shader *DeclaringShader(Signature Shader::*);
+
+// the shader (or one of its bases other than IVertexShader) declares the operator() of this signature
+template<class VertexShader, class Signature>
+concept OverridesOperator = requires { DeclaringShader<Signature>(&VertexShader::operator()); }
+  && !std::is_same_v<decltype(DeclaringShader<Signature>(&VertexShader::operator())), IVertexShader *>;
+
+// VertexInput mask of the shader, from the operators it overrides
 template<class VertexShader>
-concept IsValidVertexShader = IsVertexShader<VertexShader> && requires (const VertexShader &s, IVertex &v)
+  requires IsVertexShader<VertexShader>
+constexpr uint8_t VertexShaderInputs()
 {
-  s(v, 0);
+  if constexpr (OverridesOperator<VertexShader, void(const VertexBatch &) const>)
+    return uint8_t(VertexInput::IVERTEX) | uint8_t(VertexInput::ATTRIBUTES);
+
+  uint8_t inputs = 0;
+  if constexpr (OverridesOperator<VertexShader, glm::vec4(const IVertex &, size_t) const>
+             || OverridesOperator<VertexShader, glm::vec4(const IVertex &, size_t, float *) const>)
+    inputs |= uint8_t(VertexInput::IVERTEX);
+  if constexpr (OverridesOperator<VertexShader, glm::vec4(const VertexAttributes &, size_t, float *) const>)
+    inputs |= uint8_t(VertexInput::ATTRIBUTES);
+  return inputs;
+}
+
+// the shader must override the operator of at least one kind of vertex input
+template<class VertexShader>
+concept IsValidVertexShader = IsVertexShader<VertexShader> && VertexShaderInputs<VertexShader>() != 0;
+
+// the shader can be called directly with a Vertex (see the typed gl::DrawElements)
+template<class VertexShader, class Vertex>
+concept IsVertexShaderFor = IsVertexShader<VertexShader> && requires (const VertexShader &s, const Vertex &v)
+{
+  s(v, size_t(0));
 };
 
 
 template<class FragmentShader>
 concept IsFragmentShader = std::is_base_of<IFragmentShader, FragmentShader>::value;
 
-//template<class FragmentShader>
-//concept IsValidFragmentShader = requires (const FragmentShader &s){};
+template<class FragmentShader>
+concept IsValidFragmentShader = IsFragmentShader<FragmentShader> && requires (const FragmentShader &s, const FragmentQuad &q, glm::vec4 (&c)[4])
+{
+  s(q, c);
+};
 
 template<class Shader>
 concept IsShader = IsVertexShader<Shader> || IsFragmentShader<Shader>;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <glm/vec4.hpp>
+
+#include <array>
+
+namespace gl
+{
+  // Component types of the vertex attributes
+  enum class AttribType
+  {
+    BYTE,
+    UNSIGNED_BYTE,
+    SHORT,
+    UNSIGNED_SHORT,
+    INT,
+    UNSIGNED_INT,
+    FLOAT
+  };
+
+  using enum AttribType;
+
+  // How the attributes of a buffer are stored for the vertex shader
+  enum class StorageMode
+  {
+    INTERLEAVED,        // as uploaded
+    STRUCTURE_OF_ARRAYS // as uploaded, plus a copy of every attribute component in its own stream (see VertexStreams)
+  };
+
+  using enum StorageMode;
+}
+
+constexpr size_t MAX_VERTEX_ATTRIBS = 8;
+
+// Where and how one attribute is stored in a vertex
+struct VertexAttrib
+{
+  bool enabled = false;
+
+  size_t offset = 0;     // in bytes, from the start of the vertex
+  unsigned int count = 0; // number of components (1 to 4)
+  gl::AttribType type = gl::FLOAT;
+  bool normalized = false; // integer components are mapped to [0, 1] (or [-1, 1] if signed)
+};
+
+// Attributes of one vertex as read by the vertex fetch, missing components default to (0, 0, 0, 1)
+struct VertexAttributes
+{
+  glm::vec4 values[MAX_VERTEX_ATTRIBS];
+
+  const glm::vec4 &operator[](size_t index) const { return values[index]; }
+};
+
+// Describes the content of a plain data vertex (no IVertex needed) so the vertex fetch can read its attributes
+class VertexLayout
+{
+public:
+  void SetAttribute(unsigned int index, const VertexAttrib &attribute) { m_attributes[index] = attribute; }
+  const VertexAttrib &GetAttribute(unsigned int index) const { return m_attributes[index]; }
+
+  void Clear() { m_attributes = {}; }
+
+  // true if no attribute is enabled
+  bool Empty() const;
+
+  // reads every enabled attribute of the vertex
+  void Fetch(const byte_t *vertex, VertexAttributes &attributes) const;
+
+private:
+  std::array<VertexAttrib, MAX_VERTEX_ATTRIBS> m_attributes;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "core/types.h"
+#include "graphics/VertexLayout.hpp"
+
+#include <glm/mat4x4.hpp>
+
+#include <array>
+#include <vector>
+
+// Structure of arrays copy of the attributes of a buffer: one float stream per attribute component (x[], y[], z[], ...).
+// Streams are 32 bytes aligned and padded to a multiple of 8 vertices, so they can be read 8 (AVX) or 4 (SSE) vertices at a time.
+class VertexStreams
+{
+public:
+  static constexpr size_t BLOCK_SIZE = 8; // floats
+
+public:
+  // Converts the interleaved vertices described by the layout into streams
+  void Build(const byte_t *vertices, size_t vertexSize, size_t vertexCount, const VertexLayout &layout);
+  // Converts the vertices [first, end) again, the layout and the vertex count must be the ones of the last Build
+  void Update(const byte_t *vertices, size_t vertexSize, size_t first, size_t end, const VertexLayout &layout);
+  void Clear();
+
+  bool Empty() const { return m_data.empty(); }
+  size_t Count() const { return m_vertexCount; }
+
+  // nullptr if the component isn't part of the attribute (or the attribute is disabled or out of range)
+  const float *Stream(unsigned int attribute, unsigned int component) const;
+
+  // Writes `matrix * attribute` of the vertices [first, first + count) to positions, 4 vertices at a time (SSE).
+  // The missing components are read as (0, 0, 0, 1), returns false if the attribute or the vertices aren't in the streams
+  bool Transform(unsigned int attribute, const glm::mat4 &matrix, size_t first, size_t count, glm::vec4 *positions) const;
+
+private:
+  struct alignas(32) Block
+  {
+    float values[BLOCK_SIZE];
+  };
+
+  static constexpr size_t NO_STREAM = ~size_t(0);
+
+  size_t m_vertexCount = 0;
+  size_t m_blocksPerStream = 0;
+
+  // first block of every stream, indexed by attribute * 4 + component
+  std::array<size_t, MAX_VERTEX_ATTRIBS * 4> m_streams;
+  std::vector<Block> m_data;
+};
@@ -4,6 +4,10 @@
 
 #include "graphics/IVertex.hpp"
 #include "graphics/Shader.hpp"
+#include "graphics/Capabilities.hpp"
+#include "graphics/VertexLayout.hpp"
+#include "graphics/ElementBuffer.hpp"
+#include "graphics/MeshFile.hpp"
 
 #include <vector>
 #include <optional>
@@ -29,11 +33,32 @@ namespace gl
 
   void Viewport(float x, float y, float width, float height);
   void Clear();
+  // depth written in the depth buffer by Clear
+  void ClearDepth(float depth);
+
+  void Enable(Capability capability);
+  void Disable(Capability capability);
+  bool IsEnabled(Capability capability);
+
+  // Threading API, the parallel stages are split in chunks of at least `grainSize` elements
+  // (0 threads uses every hardware thread, 1 runs everything on the calling thread)
+  void ThreadCount(size_t count);
+  void GrainSize(size_t grainSize);
+
+  // Memory ceiling (in bytes) of the transient buffers of a draw call, bigger draws are streamed through the pipeline
+  // in chunks of indices (the triangles of a chunk are drawn before the ones of the next chunk). 0 disables the streaming
+  void GeometryBudget(size_t bytes);
+
+  // Culling API (only used when CULL_FACE is enabled)
+  void CullFace(Face face);
+  void FrontFace(Winding winding);
 
   // Buffer API
   void CreateBuffers(size_t size, int *buffers);
   void DeleteBuffers(size_t size, int *buffers);
   void BindBuffer(int bufferId);
+  // buffer given to the vertex shaders of the instanced draw calls (see IVertexShader::BeginInstance), 0 to unbind
+  void BindInstanceBuffer(int bufferId);
 
   template<class Vertex>
     requires IsVertex<Vertex>
@@ -56,6 +81,78 @@ namespace gl
     return Context::Instance()->BufferData<Vertex>(vertices.size(), vertices.begin());
   }
 
+  // Overwrites `count` vertices of the bound buffer from the vertex `offset`, in place: the buffer already holds them
+  // (uploaded with BufferData as the same vertex type) so nothing is reallocated and only these vertices are copied
+  void BufferSubData(size_t offset, size_t count, const void *data, size_t vertexSize);
+
+  template<class Vertex>
+    requires IsVertex<Vertex>
+  void BufferSubData(size_t offset, size_t count, const Vertex *data)
+  {
+    return BufferSubData(offset, count, static_cast<const void *>(data), sizeof(Vertex));
+  }
+
+  template<class Vertex>
+    requires IsVertex<Vertex>
+  void BufferSubData(size_t offset, const std::vector<Vertex> &vertices)
+  {
+    return BufferSubData(offset, vertices.size(), static_cast<const void *>(vertices.data()), sizeof(Vertex));
+  }
+
+  // Pointer to the vertices [offset, offset + count) of the bound buffer, nullptr if they aren't all in it.
+  // The mapping is persistent: the draw calls read the vertices straight from it, and the pointer stays valid until
+  // new data is uploaded with BufferData. The written vertices are reported with FlushMappedBufferRange (offset
+  // relative to the mapped range) or UnmapBuffer (the whole range), so the streams of a STRUCTURE_OF_ARRAYS buffer
+  // only convert these ones again
+  void *MapBuffer(size_t offset, size_t count, size_t vertexSize);
+
+  template<class Vertex>
+    requires IsVertex<Vertex>
+  Vertex *MapBuffer(size_t offset, size_t count)
+  {
+    return static_cast<Vertex *>(MapBuffer(offset, count, sizeof(Vertex)));
+  }
+
+  void FlushMappedBufferRange(size_t offset, size_t count);
+  void UnmapBuffer();
+
+  // Element buffer API, the indices are uploaded once (as uint16_t or uint32_t) and drawn with DrawElementBuffer
+  void CreateElementBuffers(size_t size, int *buffers);
+  void DeleteElementBuffers(size_t size, int *buffers);
+  void BindElementBuffer(int bufferId);
+
+  template<class Index>
+    requires IsIndex<Index>
+  void ElementData(size_t size, const Index *indices)
+  {
+    return Context::Instance()->ElementData<Index>(size, indices);
+  }
+
+  template<class Index>
+    requires IsIndex<Index>
+  void ElementData(const std::vector<Index> &indices)
+  {
+    return Context::Instance()->ElementData<Index>(indices.size(), indices.data());
+  }
+
+  template<class Index>
+    requires IsIndex<Index>
+  void ElementData(std::initializer_list<Index> indices)
+  {
+    return Context::Instance()->ElementData<Index>(indices.size(), indices.begin());
+  }
+
+  // Maps the vertices (and their layout) of the mesh file in the bound buffer and its indices in the bound element buffer,
+  // the buffers draw the mapped file in place until new data is uploaded to them
+  void BufferMesh(const Ref<MeshFile> &mesh);
+
+  // Describes the attribute `index` of the vertices of the bound buffer (for the vertices that don't inherit IVertex),
+  // offset is in bytes from the start of the vertex, the stride is the size of the uploaded vertex type
+  void VertexAttribPointer(unsigned int index, unsigned int count, AttribType type, bool normalized, size_t offset);
+  void DisableVertexAttrib(unsigned int index);
+  // STRUCTURE_OF_ARRAYS makes the attributes of the bound buffer available as streams to the vertex shaders
+  void VertexStorage(StorageMode storage);
+
   // shader API
   int CreateProgram();
   void DeleteProgram(int programId);
@@ -67,7 +164,7 @@ namespace gl
   consteval void CompileShader() {}
 
   template<class Shader>
-    requires IsFragmentShader<Shader>
+    requires IsValidFragmentShader<Shader>
   consteval void CompileShader() {}
 
   template<class Shader>
@@ -81,7 +178,27 @@ namespace gl
       return;
 
     Program &program = *program_opt.value();
-    program.Attach(new Shader(program));
+    if constexpr (IsVertexShader<Shader>)
+      program.Attach(new Shader(program), VertexShaderInputs<Shader>());
+    else
+      program.Attach(new Shader(program));
+  }
+
+  // returns -1 if the program doesn't exist
+  int GetUniformLocation(int programId, const std::string_view name);
+
+  template<class T>
+  void Uniform(int programId, int location, const T &value)
+  {
+    using U = std::remove_cvref_t<T>;
+    std::optional<Program *> program_opt;
+
+    program_opt = Context::Instance()->GetProgram(programId);
+    if (!program_opt.has_value())
+      return;
+
+    Program &program = *program_opt.value();
+    return program.UploadUniform<U>(location, value);
   }
 
   template<class T>
@@ -109,7 +226,7 @@ namespace gl
       return;
 
     Program &program = *program_opt.value();
-    return program.UploadUniform<U>(name, std::forward<U>(value));
+    return program.UploadUniform<U>(name, value);
   }
 
   // Draw calls API
@@ -118,4 +235,12 @@ namespace gl
 
   void DrawElements(RenderMode mode, const std::vector<int> &indices);
   void DrawElements(RenderMode mode, size_t indicesCount, const int *indices);
+
+  // draws `count` indices of the bound element buffer, starting at the index `offset`
+  void DrawElementBuffer(RenderMode mode, size_t count, size_t offset = 0);
+
+  // draws the same indices `instanceCount` times, the primitives are only assembled once
+  void DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount);
+  void DrawElementsInstanced(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount);
+  void DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "core/types.h"
 #include <array>
+#include <utility>
 #include <concepts>
 
 template<size_t VertexCount>
@@ -123,6 +124,31 @@ public:
   template<class Primitive>
   void Reserve(size_t size) { return GrowTo(size * sizeof(Primitive)); }
 
+  // Sets the buffer to `count` primitives of the same type without initializing them
+  template<class Primitive>
+  void Resize(size_t count)
+  {
+    GrowTo(count * sizeof(Primitive));
+    m_pos = count * sizeof(Primitive);
+    m_count = count;
+  }
+
+  void CopyFrom(const PrimitiveBuffer &other)
+  {
+    GrowTo(other.m_pos);
+    memcpy(m_data.get(), other.m_data.get(), other.m_pos);
+    m_pos = other.m_pos;
+    m_count = other.m_count;
+  }
+
+  void Swap(PrimitiveBuffer &other)
+  {
+    std::swap(m_pos, other.m_pos);
+    std::swap(m_size, other.m_size);
+    std::swap(m_count, other.m_count);
+    std::swap(m_data, other.m_data);
+  }
+
   IPrimitive &operator[](size_t idx);
   const IPrimitive &operator[](size_t idx) const;
 
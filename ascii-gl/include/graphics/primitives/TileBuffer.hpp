@@ -0,0 +1,55 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Splits the framebuffer into square tiles of TILE_SIZE pixels.
+// Each tile holds the (ordered) list of the primitives overlapping it,
+// so that every tile can be rasterized independently from the others.
+class TileBuffer
+{
+public:
+  static constexpr unsigned int TILE_SIZE = 16;
+
+  struct Tile
+  {
+    glm::ivec2 min; // first pixel of the tile (inclusive)
+    glm::ivec2 max; // last pixel of the tile (inclusive)
+
+    std::vector<uint32_t> primitives;
+  };
+
+public:
+  // Resize the grid so it covers a framebuffer of the given size (in pixels) and empties every tile
+  void Resize(unsigned int width, unsigned int height);
+
+  // Empties every tile without releasing their memory
+  void Clear();
+
+  // Register a primitive in every tile overlapped by the given pixel bounds (inclusive)
+  void Insert(uint32_t primitive, glm::ivec2 min, glm::ivec2 max);
+
+  unsigned int Width() const { return m_width; }
+  unsigned int Height() const { return m_height; }
+  size_t Count() const { return m_tiles.size(); }
+
+  Tile &operator[](size_t idx) { return m_tiles[idx]; }
+  const Tile &operator[](size_t idx) const { return m_tiles[idx]; }
+
+  std::vector<Tile>::iterator begin() { return m_tiles.begin(); }
+  std::vector<Tile>::iterator end() { return m_tiles.end(); }
+  std::vector<Tile>::const_iterator begin() const { return m_tiles.begin(); }
+  std::vector<Tile>::const_iterator end() const { return m_tiles.end(); }
+
+private:
+  unsigned int m_pixelWidth = 0;
+  unsigned int m_pixelHeight = 0;
+
+  unsigned int m_width = 0;  // in tiles
+  unsigned int m_height = 0; // in tiles
+
+  std::vector<Tile> m_tiles;
+};
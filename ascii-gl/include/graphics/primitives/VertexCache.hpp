@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <vector>
+
+// Deduplicates the vertices referenced by the indices of a draw call so every one of them is shaded exactly once,
+// whatever the size of the bound buffer. The indices are remapped into the list of the unique vertices.
+// The lookup table is sized by the indices (a chunk when the draw is streamed), not by the buffer: the buffers smaller
+// than the table are indexed directly, the others are hashed
+class VertexCache
+{
+public:
+  // Returns false if an index is outside of [0, vertexCount).
+  // Instantiated for the indices of the draw calls (int) and of the element buffers (uint16_t and uint32_t)
+  template<class Index>
+  bool Build(size_t vertexCount, size_t indicesCount, const Index *indices);
+
+  // index in the bound buffer of every vertex to shade, in order of first appearance
+  const std::vector<unsigned int> &Vertices() const { return m_vertices; }
+
+  // the draw call indices, remapped into Vertices()
+  const std::vector<unsigned int> &Indices() const { return m_indices; }
+
+  // at least 2 entries per index (a power of two), the memory counted by Pipeline::ChunkSize
+  static size_t TableSize(size_t indicesCount);
+
+private:
+  // the entries are only valid if their stamp matches the current generation, so nothing is cleared between draws
+  uint32_t m_generation = 0;
+  std::vector<uint32_t> m_stamps;
+  std::vector<uint32_t> m_keys; // vertex of the entry, when hashed
+  std::vector<unsigned int> m_slots;
+
+  std::vector<unsigned int> m_vertices;
+  std::vector<unsigned int> m_indices;
+};
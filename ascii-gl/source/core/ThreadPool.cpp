@@ -0,0 +1,138 @@
+#include "core/ThreadPool.hpp"
+
+#include <algorithm>
+#include <optional>
+
+// index of the queue of the current thread, external threads have none
+static thread_local size_t s_queue = size_t(-1);
+
+ThreadPool::ThreadPool(size_t threadCount, size_t grainSize) : m_grainSize(std::max<size_t>(1, grainSize))
+{
+  SetThreadCount(threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+}
+
+void ThreadPool::SetThreadCount(size_t threadCount)
+{
+  if (!threadCount)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  if (threadCount == ThreadCount())
+    return;
+
+  Stop();
+  Start(threadCount - 1);
+}
+
+void ThreadPool::Start(size_t workerCount)
+{
+  m_stop = false;
+
+  m_queues.clear();
+  for (size_t i = 0; i < workerCount; ++i)
+    m_queues.push_back(std::make_unique<Queue>());
+
+  for (size_t i = 0; i < workerCount; ++i)
+    m_threads.emplace_back(&ThreadPool::Work, this, i);
+}
+
+void ThreadPool::Stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+
+  for (std::thread &thread : m_threads)
+    thread.join();
+  m_threads.clear();
+}
+
+void ThreadPool::Run(Job &job, size_t count, size_t grainSize)
+{
+  // a few chunks per thread so the ones finishing early can steal from the others
+  const size_t chunkSize = std::max(grainSize, (count + ThreadCount() * 4 - 1) / (ThreadCount() * 4));
+  const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+  job.remaining = chunkCount;
+
+  // the chunks are dealt to the queues, starting with the one of the caller (if it's a worker)
+  const size_t first = s_queue < m_queues.size() ? s_queue : 0;
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+  {
+    Queue &queue = *m_queues[(first + chunk) % m_queues.size()];
+    const size_t begin = chunk * chunkSize;
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back({ &job, begin, std::min(count, begin + chunkSize) });
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending += chunkCount;
+  }
+  m_wake.notify_all();
+
+  // the caller works too (on any job) until its own one is done
+  while (job.remaining.load(std::memory_order_acquire))
+  {
+    if (!RunTask(s_queue))
+      std::this_thread::yield();
+  }
+}
+
+bool ThreadPool::RunTask(size_t own)
+{
+  std::optional<Task> task;
+
+  for (size_t i = 0; i < m_queues.size() && !task.has_value(); ++i)
+  {
+    const size_t index = own < m_queues.size() ? (own + i) % m_queues.size() : i;
+    Queue &queue = *m_queues[index];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      continue;
+
+    // the owner takes the last queued chunk (still in cache), the thieves the first one
+    if (index == own)
+    {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    else
+    {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+    }
+  }
+
+  if (!task.has_value())
+    return false;
+
+  --m_pending;
+  task->job->run(task->job->func, task->begin, task->end);
+  task->job->remaining.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void ThreadPool::Work(size_t index)
+{
+  s_queue = index;
+
+  while (true)
+  {
+    if (RunTask(index))
+      continue;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_wake.wait(lock, [this]() { return m_stop || m_pending.load() > 0; });
+    if (m_stop)
+      return;
+  }
+}
@@ -0,0 +1,230 @@
+#include "graphics/CommandList.hpp"
+#include "graphics/Context.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace gl
+{
+  // draw function of the generic draw calls
+  static void GenericDraw(RenderMode mode, size_t count, const int *indices, size_t offset, size_t instanceCount)
+  {
+    if (indices)
+      return DrawElementsInstanced(mode, count, indices, instanceCount);
+    return DrawElementBufferInstanced(mode, count, offset, instanceCount);
+  }
+
+  void CommandList::Clear()
+  {
+    m_program.reset();
+    m_buffer.reset();
+    m_instanceBuffer.reset();
+    m_elementBuffer.reset();
+
+    m_draws.clear();
+    m_indices.clear();
+
+    m_uniforms.clear();
+    m_uniformData.clear();
+    m_uploads.clear();
+  }
+
+  void CommandList::DrawElements(RenderMode mode, const std::vector<int> &indices)
+  {
+    return RecordIndices(mode, indices.size(), indices.data(), 1, &GenericDraw);
+  }
+
+  void CommandList::DrawElements(RenderMode mode, size_t indicesCount, const int *indices)
+  {
+    return RecordIndices(mode, indicesCount, indices, 1, &GenericDraw);
+  }
+
+  void CommandList::DrawElementBuffer(RenderMode mode, size_t count, size_t offset)
+  {
+    return RecordElements(mode, count, offset, 1, &GenericDraw);
+  }
+
+  void CommandList::DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount)
+  {
+    return RecordIndices(mode, indices.size(), indices.data(), instanceCount, &GenericDraw);
+  }
+
+  void CommandList::DrawElementsInstanced(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount)
+  {
+    return RecordIndices(mode, indicesCount, indices, instanceCount, &GenericDraw);
+  }
+
+  void CommandList::DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount)
+  {
+    return RecordElements(mode, count, offset, instanceCount, &GenericDraw);
+  }
+
+  void CommandList::RecordIndices(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount, DrawFunction function)
+  {
+    // the indices are copied, the caller's ones don't have to outlive the list
+    const size_t first = m_indices.size();
+    m_indices.insert(m_indices.end(), indices, indices + indicesCount);
+
+    return Record(mode, false, first, indicesCount, instanceCount, function);
+  }
+
+  void CommandList::RecordElements(RenderMode mode, size_t count, size_t offset, size_t instanceCount, DrawFunction function)
+  {
+    return Record(mode, true, offset, count, instanceCount, function);
+  }
+
+  void CommandList::Record(RenderMode mode, bool elements, size_t first, size_t count, size_t instanceCount, DrawFunction function)
+  {
+    if (!count || !instanceCount)
+      return;
+
+    // the list starts with nothing bound
+    const int program = m_program.value_or(0);
+    std::map<int, size_t>::const_iterator uploads = m_uploads.find(program);
+
+    m_draws.push_back({
+      program,
+      m_buffer.value_or(0),
+      m_instanceBuffer.value_or(0),
+      m_elementBuffer.value_or(0),
+      uploads == m_uploads.end() ? 0 : uploads->second,
+      mode,
+      function,
+      elements,
+      first,
+      count,
+      instanceCount
+    });
+  }
+
+
+  // the indices of two draws can only be concatenated if the primitives don't connect consecutive indices
+  static bool IsMergeable(RenderMode mode)
+  {
+    return mode == POINTS || mode == LINES || mode == TRIANGLES;
+  }
+
+  // the indices of `a` must make whole primitives, or its leftover ones would start a primitive with the indices of `b`
+  static bool AreCompatible(const CommandList::DrawCommand &a, const CommandList::DrawCommand &b)
+  {
+    return IsMergeable(a.mode)
+      && (a.mode != TRIANGLES || a.count % 3 == 0)
+      && (a.mode != LINES || a.count % 2 == 0)
+      && std::tie(a.program, a.uniforms, a.buffer, a.instanceBuffer, a.mode, a.function, a.elements, a.instanceCount)
+      == std::tie(b.program, b.uniforms, b.buffer, b.instanceBuffer, b.mode, b.function, b.elements, b.instanceCount)
+      // the element ranges must follow each other in the same element buffer
+      && (!a.elements || (a.elementBuffer == b.elementBuffer && a.first + a.count == b.first));
+  }
+
+  void Submit(const CommandList &commands, bool reorder)
+  {
+    Context &context = *Context::Instance();
+    const std::vector<CommandList::DrawCommand> &draws = commands.Draws();
+    const std::vector<CommandList::UniformCommand> &uniforms = commands.Uniforms();
+
+    // draws grouped by state, the recording order is kept within a group
+    std::vector<size_t> order(draws.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    if (reorder)
+    {
+      std::stable_sort(order.begin(), order.end(), [&draws](size_t lhs, size_t rhs) {
+        const CommandList::DrawCommand &a = draws[lhs];
+        const CommandList::DrawCommand &b = draws[rhs];
+
+        return std::tie(a.program, a.uniforms, a.buffer, a.instanceBuffer, a.elementBuffer, a.mode, a.elements)
+             < std::tie(b.program, b.uniforms, b.buffer, b.instanceBuffer, b.elementBuffer, b.mode, b.elements);
+      });
+    }
+
+    // uploads grouped by program, in recording order, each program consumes its own ones as its draws are executed
+    std::vector<size_t> uploads(uniforms.size());
+    std::iota(uploads.begin(), uploads.end(), 0);
+    std::stable_sort(uploads.begin(), uploads.end(), [&uniforms](size_t lhs, size_t rhs) {
+      return uniforms[lhs].program < uniforms[rhs].program;
+    });
+
+    // uploads of every program: position of the first one in `uploads`, their number and how many are done
+    struct Uploads
+    {
+      size_t first = 0;
+      size_t count = 0;
+      size_t done = 0;
+    };
+
+    std::map<int, Uploads> pending;
+    for (size_t i = 0; i < uploads.size(); ++i)
+    {
+      Uploads &program = pending[uniforms[uploads[i]].program];
+      if (!program.count++)
+        program.first = i;
+    }
+
+    // does the `count` first uploads recorded for the program (the ones that are still pending)
+    const auto upload = [&](int programId, size_t count) {
+      std::map<int, Uploads>::iterator it = pending.find(programId);
+      if (it == pending.end())
+        return;
+
+      Uploads &range = it->second;
+      std::optional<Program *> program = context.GetProgram(programId);
+      for (; range.done < std::min(count, range.count); ++range.done)
+      {
+        const CommandList::UniformCommand &uniform = uniforms[uploads[range.first + range.done]];
+        if (program.has_value())
+          uniform.upload(*program.value(), uniform.location, commands.UniformData(uniform.offset));
+      }
+    };
+
+    // scratch indices of the merged draws
+    std::vector<int> merged;
+
+    for (size_t i = 0; i < order.size();)
+    {
+      const CommandList::DrawCommand &draw = draws[order[i]];
+
+      // extend the draw with the compatible ones that follow it
+      size_t count = draw.count;
+      size_t end = i + 1;
+      while (end < order.size() && AreCompatible(draws[order[end - 1]], draws[order[end]]))
+        count += draws[order[end++]].count;
+
+      const int *indices = nullptr;
+      if (!draw.elements)
+      {
+        indices = commands.Indices(draw.first);
+        if (end - i > 1)
+        {
+          merged.clear();
+          for (size_t j = i; j < end; ++j)
+            merged.insert(merged.end(), commands.Indices(draws[order[j]].first), commands.Indices(draws[order[j]].first + draws[order[j]].count));
+          indices = merged.data();
+        }
+      }
+
+      upload(draw.program, draw.uniforms);
+
+      context.UseProgram(draw.program);
+      context.BindBuffer(draw.buffer);
+      context.BindInstanceBuffer(draw.instanceBuffer);
+      context.BindElementBuffer(draw.elementBuffer);
+
+      draw.function(draw.mode, count, indices, draw.first, draw.instanceCount);
+      i = end;
+    }
+
+    // the uploads that aren't followed by any draw
+    for (const auto &[programId, range] : pending)
+      upload(programId, range.count);
+
+    if (commands.BoundProgram().has_value())
+      context.UseProgram(commands.BoundProgram().value());
+    if (commands.BoundBuffer().has_value())
+      context.BindBuffer(commands.BoundBuffer().value());
+    if (commands.BoundInstanceBuffer().has_value())
+      context.BindInstanceBuffer(commands.BoundInstanceBuffer().value());
+    if (commands.BoundElementBuffer().has_value())
+      context.BindElementBuffer(commands.BoundElementBuffer().value());
+  }
+}
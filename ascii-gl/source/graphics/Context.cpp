@@ -19,7 +19,7 @@ std::optional<Program*> Context::GetProgram(int programId)
   if (!IsProgram(programId))
     return std::nullopt;
 
-  return &m_programs[programId];
+  return m_programs.Get(programId);
 }
 
 
@@ -28,7 +28,7 @@ std::optional<Buffer*> Context::GetBuffer(int bufferId)
   if (!IsBuffer(bufferId))
     return std::nullopt;
 
-  return &m_vertexBuffers[bufferId];
+  return m_vertexBuffers.Get(bufferId);
 }
 
 std::optional<Buffer*> Context::GetBoundBuffer()
@@ -36,6 +36,24 @@ std::optional<Buffer*> Context::GetBoundBuffer()
   return GetBuffer(m_bound_buffer);
 }
 
+std::optional<Buffer*> Context::GetBoundInstanceBuffer()
+{
+  return GetBuffer(m_bound_instance_buffer);
+}
+
+std::optional<ElementBuffer*> Context::GetElementBuffer(int bufferId)
+{
+  if (!IsElementBuffer(bufferId))
+    return std::nullopt;
+
+  return m_elementBuffers.Get(bufferId);
+}
+
+std::optional<ElementBuffer*> Context::GetBoundElementBuffer()
+{
+  return GetElementBuffer(m_bound_element_buffer);
+}
+
 std::vector<glm::vec4> &Context::GetGeometryBuffer(size_t vertexCount)
 {
   // Reserve memory for the geometry buffer only if not enough
@@ -47,58 +65,92 @@ std::vector<glm::vec4> &Context::GetGeometryBuffer(size_t vertexCount)
   return m_geometryBuffer;
 }
 
+std::vector<uint8_t> &Context::GetProjectedVertices(size_t vertexCount)
+{
+  m_projectedVertices.resize(vertexCount);
+  return m_projectedVertices;
+}
+
+std::vector<float> &Context::GetVaryingBuffer(size_t vertexCount, size_t varyingCount)
+{
+  m_varyingCount = varyingCount;
+  m_varyingBuffer.resize(vertexCount * varyingCount);
+  return m_varyingBuffer;
+}
+
 bool Context::IsBuffer(int bufferId) const
 {
-  return bufferId && m_vertexBuffers.contains(bufferId);
+  return m_vertexBuffers.Contains(bufferId);
 }
 
-int Context::CreateBuffer(int minBufferId) const
+int Context::CreateBuffer()
 {
-  int bufferId = std::max(1, minBufferId);
-  while (IsBuffer(bufferId))
-    ++bufferId;
-  return bufferId;
+  return m_vertexBuffers.Create();
 }
 
 void Context::DeleteBuffer(int bufferId)
 {
-  if (!IsBuffer(bufferId))
-    return;
-  m_vertexBuffers.erase(bufferId);
+  // also releases the ids that were created but never bound
+  m_vertexBuffers.Erase(bufferId);
 }
 
 void Context::BindBuffer(int bufferId)
 {
-  if (!IsBuffer(bufferId))
-    m_vertexBuffers[bufferId] = Buffer();
+  // 0 unbinds, any other id gets its buffer (created on the first bind)
+  if (bufferId)
+    m_vertexBuffers.Emplace(bufferId);
   m_bound_buffer = bufferId;
 }
 
+void Context::BindInstanceBuffer(int bufferId)
+{
+  if (bufferId)
+    m_vertexBuffers.Emplace(bufferId);
+  m_bound_instance_buffer = bufferId;
+}
+
+bool Context::IsElementBuffer(int bufferId) const
+{
+  return m_elementBuffers.Contains(bufferId);
+}
+
+int Context::CreateElementBuffer()
+{
+  return m_elementBuffers.Create();
+}
+
+void Context::DeleteElementBuffer(int bufferId)
+{
+  m_elementBuffers.Erase(bufferId);
+}
+
+void Context::BindElementBuffer(int bufferId)
+{
+  if (bufferId)
+    m_elementBuffers.Emplace(bufferId);
+  m_bound_element_buffer = bufferId;
+}
+
 
 bool Context::IsProgram(int programId) const
 {
-  return programId && m_programs.contains(programId);
+  return m_programs.Contains(programId);
 }
 
-int Context::CreateProgram() const
+int Context::CreateProgram()
 {
-  int programId = 1;
-  while (IsProgram(programId))
-    ++programId;
-  return programId;
+  return m_programs.Create();
 }
 
 void Context::DeleteProgram(int programId)
 {
-  if (!IsProgram(programId))
-    return;
-  m_programs.erase(programId);
+  m_programs.Erase(programId);
 }
 
 void Context::UseProgram(int programId)
 {
-  if (!IsProgram(programId))
-    m_programs[programId] = Program();
+  if (programId)
+    m_programs.Emplace(programId);
   m_bound_program = programId;
 }
 
@@ -0,0 +1,64 @@
+#include "graphics/DepthBuffer.hpp"
+
+#include <algorithm>
+
+void DepthBuffer::Resize(unsigned int width, unsigned int height)
+{
+  if (width == m_width && height == m_height && !Empty())
+    return;
+
+  m_width = width;
+  m_height = height;
+  m_pitch = (width + 1) & ~1u;
+
+  m_tileWidth = (width + TILE_SIZE - 1) / TILE_SIZE;
+  const unsigned int tileHeight = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+  m_depth.resize(size_t(m_pitch) * ((height + 1) & ~1u));
+  m_tiles.resize(size_t(m_tileWidth) * tileHeight);
+
+  return Clear(m_clearDepth);
+}
+
+void DepthBuffer::Clear(float depth)
+{
+  m_clearDepth = depth;
+
+  std::fill(m_depth.begin(), m_depth.end(), depth);
+  std::fill(m_tiles.begin(), m_tiles.end(), Tile{ depth, depth });
+}
+
+bool DepthBuffer::Occluded(glm::ivec2 min, glm::ivec2 max, float depth) const
+{
+  const glm::ivec2 tmin = min / int(TILE_SIZE);
+  const glm::ivec2 tmax = max / int(TILE_SIZE);
+
+  for (int ty = tmin.y; ty <= tmax.y; ++ty)
+  {
+    for (int tx = tmin.x; tx <= tmax.x; ++tx)
+    {
+      if (depth < m_tiles[ty * m_tileWidth + tx].max)
+        return false;
+    }
+  }
+  return true;
+}
+
+void DepthBuffer::UpdateTile(glm::ivec2 min, glm::ivec2 max)
+{
+  Tile &tile = GetTile(min);
+
+  tile.min = Row(min.y)[min.x];
+  tile.max = tile.min;
+
+  for (int y = min.y; y <= max.y; ++y)
+  {
+    const float *row = Row(y);
+
+    for (int x = min.x; x <= max.x; ++x)
+    {
+      tile.min = std::min(tile.min, row[x]);
+      tile.max = std::max(tile.max, row[x]);
+    }
+  }
+}
@@ -0,0 +1,205 @@
+#include "graphics/MeshFile.hpp"
+#include "graphics/Buffer.hpp"
+#include "graphics/ElementBuffer.hpp"
+
+#include "core/Log.hpp"
+
+#include "MappedFile.hpp"
+
+#include <fstream>
+
+static_assert(sizeof(MeshFile::Header) == 112, "the header layout is part of the file format");
+
+static constexpr size_t AlignUp(size_t value)
+{
+  return (value + MeshFile::ALIGNMENT - 1) / MeshFile::ALIGNMENT * MeshFile::ALIGNMENT;
+}
+
+static size_t ComponentSize(gl::AttribType type)
+{
+  switch (type)
+  {
+  case gl::BYTE:
+  case gl::UNSIGNED_BYTE:
+    return 1;
+  case gl::SHORT:
+  case gl::UNSIGNED_SHORT:
+    return 2;
+  default:
+    return 4;
+  }
+}
+
+// true if the section [offset, offset + count * size) is aligned and inside the file
+static bool IsInFile(uint64_t offset, uint64_t count, uint64_t size, size_t fileSize)
+{
+  if (offset % MeshFile::ALIGNMENT || offset > fileSize)
+    return false;
+  return !size || count <= (fileSize - offset) / size;
+}
+
+static bool IsValid(const MeshFile::Header &header, size_t fileSize)
+{
+  if (header.magic != MeshFile::MAGIC || header.version != MeshFile::VERSION)
+    return false;
+
+  if (!header.vertexSize || !IsInFile(header.vertexOffset, header.vertexCount, header.vertexSize, fileSize))
+    return false;
+
+  if (header.indexSize != 0 && header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t))
+    return false;
+  if (header.indexSize && !IsInFile(header.indexOffset, header.indexCount, header.indexSize, fileSize))
+    return false;
+
+  for (const MeshFile::Attribute &attribute : header.attributes)
+  {
+    if (!attribute.enabled)
+      continue;
+
+    if (attribute.count < 1 || attribute.count > 4 || attribute.type > uint8_t(gl::FLOAT))
+      return false;
+    if (uint64_t(attribute.offset) + attribute.count * ComponentSize(gl::AttribType(attribute.type)) > header.vertexSize)
+      return false;
+  }
+  return true;
+}
+
+Ref<MeshFile> MeshFile::Open(const std::string &path)
+{
+  Scope<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+  {
+    LOG_ERROR("MeshFile: can't map {}", path.c_str());
+    return nullptr;
+  }
+
+  if (file->Size() < sizeof(Header) || !IsValid(*reinterpret_cast<const Header *>(file->Data()), file->Size()))
+  {
+    LOG_ERROR("MeshFile: {} isn't a valid mesh file", path.c_str());
+    return nullptr;
+  }
+
+  return Ref<MeshFile>(new MeshFile(std::move(file)));
+}
+
+bool MeshFile::Write(const std::string &path, size_t vertexSize, size_t vertexCount, const void *vertices, const VertexLayout &layout,
+                     size_t indexSize, size_t indexCount, const void *indices)
+{
+  if (!vertexSize || (indexSize != 0 && indexSize != sizeof(uint16_t) && indexSize != sizeof(uint32_t)))
+  {
+    LOG_ERROR("MeshFile: invalid vertex ({} bytes) or index ({} bytes) size", vertexSize, indexSize);
+    return false;
+  }
+
+  if (!indices)
+    indexCount = 0;
+
+  Header header = {};
+  header.magic = MAGIC;
+  header.version = VERSION;
+
+  header.vertexCount = vertexCount;
+  header.vertexOffset = AlignUp(sizeof(Header));
+  header.vertexSize = uint32_t(vertexSize);
+
+  header.indexSize = indexCount ? uint32_t(indexSize) : 0;
+  header.indexCount = indexCount;
+  header.indexOffset = AlignUp(header.vertexOffset + vertexCount * vertexSize);
+
+  for (unsigned int i = 0; i < MAX_VERTEX_ATTRIBS; ++i)
+  {
+    const VertexAttrib &attribute = layout.GetAttribute(i);
+    if (attribute.enabled)
+      header.attributes[i] = { uint32_t(attribute.offset), 1, uint8_t(attribute.count), uint8_t(attribute.type), uint8_t(attribute.normalized) };
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file)
+  {
+    LOG_ERROR("MeshFile: can't open {}", path.c_str());
+    return false;
+  }
+
+  static constexpr char padding[ALIGNMENT] = {};
+
+  file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+  file.write(padding, std::streamsize(header.vertexOffset - sizeof(Header)));
+  file.write(static_cast<const char *>(vertices), std::streamsize(vertexCount * vertexSize));
+
+  if (indexCount)
+  {
+    file.write(padding, std::streamsize(header.indexOffset - (header.vertexOffset + vertexCount * vertexSize)));
+    file.write(static_cast<const char *>(indices), std::streamsize(indexCount * indexSize));
+  }
+
+  if (!file)
+  {
+    LOG_ERROR("MeshFile: can't write {}", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool MeshFile::Write(const std::string &path, const Buffer &vertices, const ElementBuffer *indices)
+{
+  if (vertices.IsIVertex())
+  {
+    LOG_ERROR("MeshFile: the vertices inheriting IVertex can't be stored");
+    return false;
+  }
+
+  if (!indices || !indices->Count())
+    return Write(path, vertices.Size(), vertices.Count(), *vertices, vertices.Layout());
+
+  if (indices->Type() == gl::UNSIGNED_SHORT)
+    return Write(path, vertices.Size(), vertices.Count(), *vertices, vertices.Layout(), sizeof(uint16_t), indices->Count(), indices->Data<uint16_t>());
+  return Write(path, vertices.Size(), vertices.Count(), *vertices, vertices.Layout(), sizeof(uint32_t), indices->Count(), indices->Data<uint32_t>());
+}
+
+MeshFile::MeshFile(Scope<MappedFile> file) : m_file(std::move(file)), m_header(reinterpret_cast<const Header *>(m_file->Data()))
+{
+}
+
+MeshFile::~MeshFile() = default;
+
+byte_t *MeshFile::Vertices() const
+{
+  return m_file->Data() + m_header->vertexOffset;
+}
+
+VertexLayout MeshFile::Layout() const
+{
+  VertexLayout layout;
+  for (unsigned int i = 0; i < MAX_VERTEX_ATTRIBS; ++i)
+  {
+    const Attribute &attribute = m_header->attributes[i];
+    if (attribute.enabled)
+      layout.SetAttribute(i, { true, attribute.offset, attribute.count, gl::AttribType(attribute.type), attribute.normalized != 0 });
+  }
+  return layout;
+}
+
+const void *MeshFile::Indices() const
+{
+  return m_file->Data() + m_header->indexOffset;
+}
+
+void MeshFile::MapVertices(Buffer &buffer)
+{
+  buffer.Clear();
+  buffer.SetMapped(VertexSize(), VertexCount(), Vertices(), shared_from_this());
+
+  const VertexLayout layout = Layout();
+  for (unsigned int i = 0; i < MAX_VERTEX_ATTRIBS; ++i)
+    buffer.SetAttribute(i, layout.GetAttribute(i));
+}
+
+void MeshFile::MapIndices(ElementBuffer &buffer)
+{
+  if (!HasIndices())
+    return buffer.Clear();
+
+  if (IndexType() == gl::UNSIGNED_SHORT)
+    return buffer.SetMapped(IndexCount(), static_cast<const uint16_t *>(Indices()), shared_from_this());
+  return buffer.SetMapped(IndexCount(), static_cast<const uint32_t *>(Indices()), shared_from_this());
+}
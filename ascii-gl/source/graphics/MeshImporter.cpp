@@ -0,0 +1,947 @@
+#include "graphics/MeshImporter.hpp"
+
+#include "core/Log.hpp"
+#include "core/ThreadPool.hpp"
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <utility>
+
+// size of the chunks of lines of the OBJ files, and number of faces of the blocks of the PLY files
+static constexpr size_t OBJ_CHUNK_SIZE = size_t(1) << 20;
+static constexpr size_t PLY_FACE_BLOCK = size_t(1) << 16;
+
+// the vertices are deduplicated in 2^SHARD_BITS independent hash tables
+static constexpr unsigned int SHARD_BITS = 8;
+static constexpr size_t SHARD_COUNT = size_t(1) << SHARD_BITS;
+
+static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+VertexLayout MeshVertex::Layout()
+{
+  VertexLayout layout;
+  layout.SetAttribute(0, { true, offsetof(MeshVertex, position), 3, gl::FLOAT, false });
+  layout.SetAttribute(1, { true, offsetof(MeshVertex, normal), 3, gl::FLOAT, false });
+  layout.SetAttribute(2, { true, offsetof(MeshVertex, texCoord), 2, gl::FLOAT, false });
+  return layout;
+}
+
+std::optional<MeshData> MeshImporter::Import(const std::string &path, ThreadPool &pool)
+{
+  std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(std::tolower(c)); });
+
+  if (extension == ".obj")
+    return ImportObj(path, pool);
+  if (extension == ".ply")
+    return ImportPly(path, pool);
+
+  LOG_ERROR("MeshImporter: unknown format of {}", path.c_str());
+  return std::nullopt;
+}
+
+
+// Wavefront OBJ
+
+// indices of the attributes of a corner of a triangle, NO_INDEX if it has none
+struct ObjCorner
+{
+  uint32_t position;
+  uint32_t texCoord;
+  uint32_t normal;
+
+  bool operator==(const ObjCorner &) const = default;
+};
+
+struct ObjCounts
+{
+  size_t positions = 0;
+  size_t texCoords = 0;
+  size_t normals = 0;
+  size_t triangles = 0;
+};
+
+// lines [begin, end) of the file
+struct ObjChunk
+{
+  const char *begin = nullptr;
+  const char *end = nullptr;
+
+  ObjCounts count = {}; // elements defined in the chunk
+  ObjCounts first = {}; // elements defined before it
+
+  const char *error = nullptr; // first invalid line
+  bool hasTexCoords = false;
+  bool hasNormals = false;
+};
+
+enum class ObjLine
+{
+  OTHER,
+  POSITION,
+  TEX_COORD,
+  NORMAL,
+  FACE
+};
+
+static bool IsBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char *SkipBlanks(const char *it, const char *end)
+{
+  while (it < end && IsBlank(*it))
+    ++it;
+  return it;
+}
+
+// calls `func(line, end)` on the lines of [begin, end) (leading blanks skipped) until it returns false
+template<class Func>
+static void ForEachLine(const char *begin, const char *end, const Func &func)
+{
+  while (begin < end)
+  {
+    const char *eol = static_cast<const char *>(std::memchr(begin, '\n', size_t(end - begin)));
+    if (!eol)
+      eol = end;
+
+    if (!func(SkipBlanks(begin, eol), eol))
+      return;
+    begin = eol + 1;
+  }
+}
+
+// reads the keyword of the line and moves `it` after it
+static ObjLine ReadKeyword(const char *&it, const char *end)
+{
+  const auto keyword = [&it, end](std::string_view name) {
+    if (size_t(end - it) <= name.size() || std::memcmp(it, name.data(), name.size()) || !IsBlank(it[name.size()]))
+      return false;
+    it += name.size();
+    return true;
+  };
+
+  if (keyword("v"))
+    return ObjLine::POSITION;
+  if (keyword("vt"))
+    return ObjLine::TEX_COORD;
+  if (keyword("vn"))
+    return ObjLine::NORMAL;
+  if (keyword("f"))
+    return ObjLine::FACE;
+  return ObjLine::OTHER;
+}
+
+// number of blank separated tokens before the end of the line or a comment
+static size_t CountTokens(const char *it, const char *end)
+{
+  size_t count = 0;
+  while ((it = SkipBlanks(it, end)) < end && *it != '#')
+  {
+    ++count;
+    while (it < end && !IsBlank(*it))
+      ++it;
+  }
+  return count;
+}
+
+// parses `count` floats, the ones after the `required` first ones are optional (and left untouched)
+static bool ParseFloats(const char *it, const char *end, float *values, size_t count, size_t required)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    it = SkipBlanks(it, end);
+    if (it < end && *it == '+')
+      ++it;
+
+    const std::from_chars_result result = std::from_chars(it, end, values[i]);
+    if (result.ec == std::errc::result_out_of_range)
+      values[i] = 0.0f;
+    else if (result.ec != std::errc())
+      return i >= required;
+    it = result.ptr;
+  }
+  return true;
+}
+
+// parses a 1-based (or negative, relative to the `defined` last ones) index of one of the `total` attributes
+static bool ParseIndex(const char *&it, const char *end, size_t defined, size_t total, uint32_t &index)
+{
+  long long value = 0;
+  const std::from_chars_result result = std::from_chars(it, end, value);
+  if (result.ec != std::errc() || value == 0)
+    return false;
+  it = result.ptr;
+
+  const long long resolved = value > 0 ? value - 1 : (long long)defined + value;
+  if (resolved < 0 || resolved >= (long long)total)
+    return false;
+
+  index = uint32_t(resolved);
+  return true;
+}
+
+// parses one `position[/[texCoord][/normal]]` corner of a face
+static bool ParseCorner(const char *&it, const char *end, const ObjCounts &defined, const ObjCounts &total, ObjCorner &corner)
+{
+  corner = { NO_INDEX, NO_INDEX, NO_INDEX };
+  if (!ParseIndex(it, end, defined.positions, total.positions, corner.position))
+    return false;
+
+  if (it < end && *it == '/')
+  {
+    ++it;
+    if (it < end && *it != '/' && !IsBlank(*it) && !ParseIndex(it, end, defined.texCoords, total.texCoords, corner.texCoord))
+      return false;
+
+    if (it < end && *it == '/')
+    {
+      ++it;
+      if (!ParseIndex(it, end, defined.normals, total.normals, corner.normal))
+        return false;
+    }
+  }
+  return it == end || IsBlank(*it);
+}
+
+static uint64_t Hash(const ObjCorner &corner)
+{
+  // splitmix64 finalizer of the packed indices
+  uint64_t hash = corner.position * 0x9E3779B97F4A7C15ull ^ (uint64_t(corner.texCoord) << 32 | corner.normal);
+  hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+  hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+  return hash ^ (hash >> 31);
+}
+
+static size_t Shard(uint64_t hash)
+{
+  return size_t(hash >> (64 - SHARD_BITS));
+}
+
+// Deduplicates the corners of the triangles, each shard of the hash space is handled by one task.
+// The vertices are then numbered by first use, like a serial deduplication would
+static void Deduplicate(const std::vector<ObjChunk> &chunks, const std::vector<ObjCorner> &corners, std::vector<uint32_t> &indices,
+                        std::vector<ObjCorner> &vertices, ThreadPool &pool)
+{
+  // corners of each chunk in each shard
+  std::vector<size_t> offsets(chunks.size() * SHARD_COUNT);
+  pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk)
+    {
+      size_t *counts = offsets.data() + chunk * SHARD_COUNT;
+      for (size_t i = chunks[chunk].first.triangles * 3; i < (chunks[chunk].first.triangles + chunks[chunk].count.triangles) * 3; ++i)
+        ++counts[Shard(Hash(corners[i]))];
+    }
+  }, 1);
+
+  // the corners are sorted by shard, then by chunk so each shard keeps them in file order
+  std::vector<size_t> shardFirst(SHARD_COUNT + 1);
+  size_t offset = 0;
+  for (size_t shard = 0; shard < SHARD_COUNT; ++shard)
+  {
+    shardFirst[shard] = offset;
+    for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+      offset += std::exchange(offsets[chunk * SHARD_COUNT + shard], offset);
+  }
+  shardFirst[SHARD_COUNT] = offset;
+
+  std::vector<uint32_t> sorted(corners.size());
+  pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk)
+    {
+      size_t *next = offsets.data() + chunk * SHARD_COUNT;
+      for (size_t i = chunks[chunk].first.triangles * 3; i < (chunks[chunk].first.triangles + chunks[chunk].count.triangles) * 3; ++i)
+        sorted[next[Shard(Hash(corners[i]))]++] = uint32_t(i);
+    }
+  }, 1);
+
+  // open addressing table of each shard, the index of a corner is its vertex in the shard until the shards are concatenated
+  std::vector<std::vector<uint32_t>> unique(SHARD_COUNT);
+  pool.ParallelFor(SHARD_COUNT, [&](size_t begin, size_t end) {
+    std::vector<uint32_t> table;
+    for (size_t shard = begin; shard < end; ++shard)
+    {
+      const size_t count = shardFirst[shard + 1] - shardFirst[shard];
+      const size_t mask = std::bit_ceil(count * 2) - 1;
+      table.assign(mask + 1, NO_INDEX); // vertex of the slot
+
+      std::vector<uint32_t> &representatives = unique[shard];
+      for (size_t i = shardFirst[shard]; i < shardFirst[shard + 1]; ++i)
+      {
+        const ObjCorner &corner = corners[sorted[i]];
+        for (size_t slot = Hash(corner) & mask;; slot = (slot + 1) & mask)
+        {
+          if (table[slot] == NO_INDEX)
+          {
+            table[slot] = uint32_t(representatives.size());
+            representatives.push_back(sorted[i]);
+          }
+          else if (corners[representatives[table[slot]]] != corner)
+            continue;
+
+          indices[sorted[i]] = table[slot];
+          break;
+        }
+      }
+    }
+  }, 1);
+
+  // the representative of a vertex is its first corner in file order, so numbering the representatives in file order
+  // numbers the vertices by first use: the representatives of each chunk are counted, then numbered from the chunk offset
+  std::vector<uint32_t> renumbered(corners.size(), NO_INDEX);
+  pool.ParallelFor(SHARD_COUNT, [&](size_t begin, size_t end) {
+    for (size_t shard = begin; shard < end; ++shard)
+      for (uint32_t representative : unique[shard])
+        renumbered[representative] = 0;
+  }, 1);
+
+  std::vector<size_t> chunkFirst(chunks.size() + 1);
+  pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk)
+    {
+      const size_t first = chunks[chunk].first.triangles * 3;
+      chunkFirst[chunk + 1] = size_t(std::count(renumbered.begin() + first, renumbered.begin() + first + chunks[chunk].count.triangles * 3, 0u));
+    }
+  }, 1);
+  for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+    chunkFirst[chunk + 1] += chunkFirst[chunk];
+
+  pool.ParallelFor(chunks.size(), [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk)
+    {
+      uint32_t next = uint32_t(chunkFirst[chunk]);
+      for (size_t i = chunks[chunk].first.triangles * 3; i < (chunks[chunk].first.triangles + chunks[chunk].count.triangles) * 3; ++i)
+        if (renumbered[i] != NO_INDEX)
+          renumbered[i] = next++;
+    }
+  }, 1);
+
+  vertices.resize(chunkFirst[chunks.size()]);
+  pool.ParallelFor(SHARD_COUNT, [&](size_t begin, size_t end) {
+    for (size_t shard = begin; shard < end; ++shard)
+    {
+      for (uint32_t representative : unique[shard])
+        vertices[renumbered[representative]] = corners[representative];
+
+      for (size_t i = shardFirst[shard]; i < shardFirst[shard + 1]; ++i)
+        indices[sorted[i]] = renumbered[unique[shard][indices[sorted[i]]]];
+    }
+  }, 1);
+}
+
+std::optional<MeshData> MeshImporter::ImportObj(const std::string &path, ThreadPool &pool)
+{
+  Scope<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+  {
+    LOG_ERROR("MeshImporter: can't map {}", path.c_str());
+    return std::nullopt;
+  }
+
+  const char *data = reinterpret_cast<const char *>(file->Data());
+  const char *dataEnd = data + file->Size();
+
+  // chunks of whole lines
+  std::vector<ObjChunk> chunks;
+  for (const char *begin = data; begin < dataEnd;)
+  {
+    const char *end = begin + std::min(OBJ_CHUNK_SIZE, size_t(dataEnd - begin));
+    if (end < dataEnd)
+    {
+      const char *eol = static_cast<const char *>(std::memchr(end, '\n', size_t(dataEnd - end)));
+      end = eol ? eol + 1 : dataEnd;
+    }
+
+    chunks.push_back({ begin, end });
+    begin = end;
+  }
+
+  // first pass, the elements of each chunk are counted so the second one knows where to store them
+  pool.ForEach(chunks.begin(), chunks.end(), [](ObjChunk &chunk) {
+    ForEachLine(chunk.begin, chunk.end, [&chunk](const char *it, const char *end) {
+      switch (ReadKeyword(it, end))
+      {
+      case ObjLine::POSITION:  ++chunk.count.positions; break;
+      case ObjLine::TEX_COORD: ++chunk.count.texCoords; break;
+      case ObjLine::NORMAL:    ++chunk.count.normals; break;
+      case ObjLine::FACE:      chunk.count.triangles += std::max<size_t>(CountTokens(it, end), 2) - 2; break;
+      default: break;
+      }
+      return true;
+    });
+  }, 1);
+
+  ObjCounts total;
+  for (ObjChunk &chunk : chunks)
+  {
+    chunk.first = total;
+    total.positions += chunk.count.positions;
+    total.texCoords += chunk.count.texCoords;
+    total.normals += chunk.count.normals;
+    total.triangles += chunk.count.triangles;
+  }
+
+  if (total.triangles * 3 >= NO_INDEX || total.positions >= NO_INDEX)
+  {
+    LOG_ERROR("MeshImporter: {} has too many triangles or vertices", path.c_str());
+    return std::nullopt;
+  }
+
+  std::vector<glm::vec3> positions(total.positions);
+  std::vector<glm::vec2> texCoords(total.texCoords);
+  std::vector<glm::vec3> normals(total.normals);
+  std::vector<ObjCorner> corners(total.triangles * 3);
+
+  // second pass, the elements are parsed in place and the faces are triangulated
+  pool.ForEach(chunks.begin(), chunks.end(), [&](ObjChunk &chunk) {
+    ObjCounts defined = chunk.first;
+
+    ForEachLine(chunk.begin, chunk.end, [&](const char *it, const char *end) {
+      const char *line = it;
+      bool valid = true;
+
+      switch (ReadKeyword(it, end))
+      {
+      case ObjLine::POSITION:
+        valid = ParseFloats(it, end, &positions[defined.positions++].x, 3, 3);
+        break;
+
+      case ObjLine::TEX_COORD:
+        valid = ParseFloats(it, end, &texCoords[defined.texCoords++].x, 2, 1);
+        break;
+
+      case ObjLine::NORMAL:
+        valid = ParseFloats(it, end, &normals[defined.normals++].x, 3, 3);
+        break;
+
+      case ObjLine::FACE:
+      {
+        // fan around the first corner
+        ObjCorner first, previous, corner;
+        for (size_t i = 0; valid && (it = SkipBlanks(it, end)) < end && *it != '#'; ++i)
+        {
+          valid = ParseCorner(it, end, defined, total, corner);
+          chunk.hasTexCoords |= corner.texCoord != NO_INDEX;
+          chunk.hasNormals |= corner.normal != NO_INDEX;
+
+          if (i >= 2)
+          {
+            ObjCorner *triangle = &corners[defined.triangles++ * 3];
+            triangle[0] = first;
+            triangle[1] = previous;
+            triangle[2] = corner;
+          }
+          if (i == 0)
+            first = corner;
+          previous = corner;
+        }
+        break;
+      }
+
+      default:
+        break;
+      }
+
+      if (!valid)
+        chunk.error = line;
+      return valid;
+    });
+  }, 1);
+
+  MeshData mesh;
+  for (const ObjChunk &chunk : chunks)
+  {
+    if (chunk.error)
+    {
+      const char *eol = static_cast<const char *>(std::memchr(chunk.error, '\n', size_t(dataEnd - chunk.error)));
+      LOG_ERROR("MeshImporter: invalid line in {}: {}", path.c_str(), std::string(chunk.error, eol ? eol : dataEnd).c_str());
+      return std::nullopt;
+    }
+
+    mesh.hasTexCoords |= chunk.hasTexCoords;
+    mesh.hasNormals |= chunk.hasNormals;
+  }
+
+  mesh.indices.resize(corners.size());
+
+  // the positions are the vertices if the faces don't reference anything else
+  if (!mesh.hasTexCoords && !mesh.hasNormals)
+  {
+    mesh.vertices.resize(positions.size());
+    pool.ParallelFor(positions.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        mesh.vertices[i] = { positions[i], glm::vec3(0.0f), glm::vec2(0.0f) };
+    });
+    pool.ParallelFor(corners.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+        mesh.indices[i] = corners[i].position;
+    });
+    return mesh;
+  }
+
+  std::vector<ObjCorner> vertices;
+  Deduplicate(chunks, corners, mesh.indices, vertices, pool);
+
+  mesh.vertices.resize(vertices.size());
+  pool.ParallelFor(vertices.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+    {
+      const ObjCorner &vertex = vertices[i];
+      mesh.vertices[i] = {
+        positions[vertex.position],
+        vertex.normal != NO_INDEX ? normals[vertex.normal] : glm::vec3(0.0f),
+        vertex.texCoord != NO_INDEX ? texCoords[vertex.texCoord] : glm::vec2(0.0f)
+      };
+    }
+  });
+  return mesh;
+}
+
+
+// binary PLY
+
+enum class PlyType
+{
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  FLOAT32,
+  FLOAT64
+};
+
+struct PlyProperty
+{
+  std::string name;
+  PlyType type;
+  std::optional<PlyType> countType; // set for the list properties
+};
+
+struct PlyElement
+{
+  std::string name;
+  size_t count = 0;
+  std::vector<PlyProperty> properties;
+};
+
+static std::optional<PlyType> ParsePlyType(std::string_view name)
+{
+  if (name == "char" || name == "int8")
+    return PlyType::INT8;
+  if (name == "uchar" || name == "uint8")
+    return PlyType::UINT8;
+  if (name == "short" || name == "int16")
+    return PlyType::INT16;
+  if (name == "ushort" || name == "uint16")
+    return PlyType::UINT16;
+  if (name == "int" || name == "int32")
+    return PlyType::INT32;
+  if (name == "uint" || name == "uint32")
+    return PlyType::UINT32;
+  if (name == "float" || name == "float32")
+    return PlyType::FLOAT32;
+  if (name == "double" || name == "float64")
+    return PlyType::FLOAT64;
+  return std::nullopt;
+}
+
+static size_t PlySize(PlyType type)
+{
+  switch (type)
+  {
+  case PlyType::INT8:
+  case PlyType::UINT8:
+    return 1;
+  case PlyType::INT16:
+  case PlyType::UINT16:
+    return 2;
+  case PlyType::FLOAT64:
+    return 8;
+  default:
+    return 4;
+  }
+}
+
+template<class T>
+static T ReadRaw(const byte_t *data, bool swap)
+{
+  byte_t bytes[sizeof(T)];
+  if (swap)
+    std::reverse_copy(data, data + sizeof(T), bytes);
+  else
+    std::memcpy(bytes, data, sizeof(T));
+
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+template<class T>
+static T ReadPly(const byte_t *data, PlyType type, bool swap)
+{
+  switch (type)
+  {
+  case PlyType::INT8:    return T(ReadRaw<int8_t>(data, swap));
+  case PlyType::UINT8:   return T(ReadRaw<uint8_t>(data, swap));
+  case PlyType::INT16:   return T(ReadRaw<int16_t>(data, swap));
+  case PlyType::UINT16:  return T(ReadRaw<uint16_t>(data, swap));
+  case PlyType::INT32:   return T(ReadRaw<int32_t>(data, swap));
+  case PlyType::UINT32:  return T(ReadRaw<uint32_t>(data, swap));
+  case PlyType::FLOAT32: return T(ReadRaw<float>(data, swap));
+  case PlyType::FLOAT64: return T(ReadRaw<double>(data, swap));
+  }
+  return T();
+}
+
+// size of the record of the element at `data`, 0 if it doesn't fit before `end`
+static size_t RecordSize(const PlyElement &element, const byte_t *data, const byte_t *end, bool swap)
+{
+  size_t size = 0;
+  for (const PlyProperty &property : element.properties)
+  {
+    if (!property.countType.has_value())
+    {
+      size += PlySize(property.type);
+      continue;
+    }
+
+    if (size + PlySize(property.countType.value()) > size_t(end - data))
+      return 0;
+
+    const int64_t count = ReadPly<int64_t>(data + size, property.countType.value(), swap);
+    if (count < 0)
+      return 0;
+    size += PlySize(property.countType.value()) + size_t(count) * PlySize(property.type);
+  }
+  return size <= size_t(end - data) ? size : 0;
+}
+
+// size of every record of the element, 0 if it has list properties
+static size_t FixedRecordSize(const PlyElement &element)
+{
+  size_t size = 0;
+  for (const PlyProperty &property : element.properties)
+  {
+    if (property.countType.has_value())
+      return 0;
+    size += PlySize(property.type);
+  }
+  return size;
+}
+
+// offset of the property in the records of the element, nullopt if it has none of the names
+static std::optional<size_t> FindProperty(const PlyElement &element, std::initializer_list<std::string_view> names, PlyType &type)
+{
+  size_t offset = 0;
+  for (const PlyProperty &property : element.properties)
+  {
+    if (std::find(names.begin(), names.end(), property.name) != names.end())
+    {
+      type = property.type;
+      return offset;
+    }
+    offset += PlySize(property.type);
+  }
+  return std::nullopt;
+}
+
+std::optional<MeshData> MeshImporter::ImportPly(const std::string &path, ThreadPool &pool)
+{
+  Scope<MappedFile> file = MappedFile::Open(path);
+  if (!file)
+  {
+    LOG_ERROR("MeshImporter: can't map {}", path.c_str());
+    return std::nullopt;
+  }
+
+  const byte_t *data = file->Data();
+  const byte_t *dataEnd = data + file->Size();
+
+  if (file->Size() < 3 || std::memcmp(data, "ply", 3))
+  {
+    LOG_ERROR("MeshImporter: {} isn't a PLY file", path.c_str());
+    return std::nullopt;
+  }
+
+  // header
+  std::vector<PlyElement> elements;
+  std::optional<bool> littleEndian;
+  bool valid = true;
+  bool ended = false;
+
+  const char *text = reinterpret_cast<const char *>(data);
+  const char *textEnd = reinterpret_cast<const char *>(dataEnd);
+  const char *body = textEnd;
+
+  ForEachLine(text, textEnd, [&](const char *it, const char *end) {
+    std::vector<std::string_view> tokens;
+    while ((it = SkipBlanks(it, end)) < end)
+    {
+      const char *token = it;
+      while (it < end && !IsBlank(*it))
+        ++it;
+      tokens.emplace_back(token, size_t(it - token));
+    }
+
+    if (tokens.empty() || tokens[0] == "comment" || tokens[0] == "obj_info" || tokens[0] == "ply")
+      return true;
+
+    if (tokens[0] == "end_header")
+    {
+      body = end + (end < textEnd);
+      ended = true;
+      return false;
+    }
+
+    if (tokens[0] == "format" && tokens.size() == 3)
+    {
+      if (tokens[1] == "binary_little_endian")
+        littleEndian = true;
+      else if (tokens[1] == "binary_big_endian")
+        littleEndian = false;
+      else
+        valid = false;
+    }
+    else if (tokens[0] == "element" && tokens.size() == 3)
+    {
+      PlyElement &element = elements.emplace_back();
+      element.name = tokens[1];
+      valid &= std::from_chars(tokens[2].data(), tokens[2].data() + tokens[2].size(), element.count).ec == std::errc();
+    }
+    else if (tokens[0] == "property" && !elements.empty() && tokens.size() == 3)
+    {
+      std::optional<PlyType> type = ParsePlyType(tokens[1]);
+      valid &= type.has_value();
+      elements.back().properties.push_back({ std::string(tokens[2]), type.value_or(PlyType::UINT8), std::nullopt });
+    }
+    else if (tokens[0] == "property" && !elements.empty() && tokens.size() == 5 && tokens[1] == "list")
+    {
+      std::optional<PlyType> countType = ParsePlyType(tokens[2]);
+      std::optional<PlyType> type = ParsePlyType(tokens[3]);
+      valid &= countType.has_value() && type.has_value();
+      elements.back().properties.push_back({ std::string(tokens[4]), type.value_or(PlyType::UINT8), countType.value_or(PlyType::UINT8) });
+    }
+    else
+      valid = false;
+
+    return valid;
+  });
+
+  if (!valid || !ended || !littleEndian.has_value())
+  {
+    LOG_ERROR("MeshImporter: {} isn't a binary PLY file", path.c_str());
+    return std::nullopt;
+  }
+
+  const bool swap = littleEndian.value() != (std::endian::native == std::endian::little);
+
+  // start of the vertices and faces, the elements before them are skipped
+  const PlyElement *vertexElement = nullptr;
+  const PlyElement *faceElement = nullptr;
+  const byte_t *vertexData = nullptr;
+  const byte_t *faceData = nullptr;
+
+  const byte_t *it = reinterpret_cast<const byte_t *>(body);
+  for (const PlyElement &element : elements)
+  {
+    if (element.name == "vertex")
+    {
+      vertexElement = &element;
+      vertexData = it;
+    }
+    else if (element.name == "face")
+    {
+      faceElement = &element;
+      faceData = it;
+    }
+
+    if (vertexElement && faceElement)
+      break;
+
+    // the faces are walked later on
+    const size_t fixedSize = FixedRecordSize(element);
+    if (fixedSize && element.count > size_t(dataEnd - it) / fixedSize)
+      valid = false;
+    else if (fixedSize)
+      it += fixedSize * element.count;
+
+    for (size_t i = 0; valid && !fixedSize && i < element.count; ++i)
+    {
+      const size_t size = RecordSize(element, it, dataEnd, swap);
+      valid = size != 0;
+      it += size;
+    }
+
+    if (!valid)
+      break;
+  }
+
+  // position, normal and texture coordinates properties of the vertices
+  PlyType positionType[3] = {}, normalType[3] = {}, texCoordType[2] = {};
+  std::optional<size_t> position[3], normal[3], texCoord[2];
+  size_t vertexSize = 0;
+
+  if (valid && vertexElement)
+  {
+    vertexSize = FixedRecordSize(*vertexElement);
+    position[0] = FindProperty(*vertexElement, { "x" }, positionType[0]);
+    position[1] = FindProperty(*vertexElement, { "y" }, positionType[1]);
+    position[2] = FindProperty(*vertexElement, { "z" }, positionType[2]);
+    normal[0] = FindProperty(*vertexElement, { "nx" }, normalType[0]);
+    normal[1] = FindProperty(*vertexElement, { "ny" }, normalType[1]);
+    normal[2] = FindProperty(*vertexElement, { "nz" }, normalType[2]);
+    texCoord[0] = FindProperty(*vertexElement, { "u", "s", "texture_u", "texture_s" }, texCoordType[0]);
+    texCoord[1] = FindProperty(*vertexElement, { "v", "t", "texture_v", "texture_t" }, texCoordType[1]);
+
+    valid = vertexSize && position[0].has_value() && position[1].has_value() && position[2].has_value()
+      && vertexElement->count <= size_t(dataEnd - vertexData) / vertexSize;
+  }
+
+  // list of the vertices of the faces
+  size_t indicesProperty = 0;
+  if (valid && faceElement)
+  {
+    const auto property = std::find_if(faceElement->properties.begin(), faceElement->properties.end(), [](const PlyProperty &property) {
+      return property.countType.has_value() && (property.name == "vertex_indices" || property.name == "vertex_index");
+    });
+    indicesProperty = size_t(property - faceElement->properties.begin());
+    valid = property != faceElement->properties.end();
+  }
+
+  if (!valid || !vertexElement || !faceElement || vertexElement->count >= NO_INDEX)
+  {
+    LOG_ERROR("MeshImporter: {} has no valid vertex and face elements", path.c_str());
+    return std::nullopt;
+  }
+
+  MeshData mesh;
+  mesh.hasNormals = normal[0].has_value() && normal[1].has_value() && normal[2].has_value();
+  mesh.hasTexCoords = texCoord[0].has_value() && texCoord[1].has_value();
+
+  mesh.vertices.resize(vertexElement->count);
+  pool.ParallelFor(mesh.vertices.size(), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+    {
+      const byte_t *vertex = vertexData + i * vertexSize;
+      MeshVertex &result = mesh.vertices[i];
+
+      result = {};
+      for (int c = 0; c < 3; ++c)
+        result.position[c] = ReadPly<float>(vertex + position[c].value(), positionType[c], swap);
+      for (int c = 0; mesh.hasNormals && c < 3; ++c)
+        result.normal[c] = ReadPly<float>(vertex + normal[c].value(), normalType[c], swap);
+      for (int c = 0; mesh.hasTexCoords && c < 2; ++c)
+        result.texCoord[c] = ReadPly<float>(vertex + texCoord[c].value(), texCoordType[c], swap);
+    }
+  });
+
+  // the faces have a variable size, they are walked once to split them in blocks that are then triangulated in parallel
+  struct FaceBlock
+  {
+    const byte_t *begin;
+    size_t faces;
+    size_t triangles;
+    bool valid = true;
+  };
+
+  std::vector<FaceBlock> blocks;
+  size_t triangles = 0;
+
+  it = faceData;
+  for (size_t face = 0; face < faceElement->count; ++face)
+  {
+    if (face % PLY_FACE_BLOCK == 0)
+      blocks.push_back({ it, std::min(PLY_FACE_BLOCK, faceElement->count - face), triangles });
+
+    size_t offset = 0;
+    for (size_t p = 0; p < faceElement->properties.size(); ++p)
+    {
+      const PlyProperty &property = faceElement->properties[p];
+      if (!property.countType.has_value())
+      {
+        offset += PlySize(property.type);
+        continue;
+      }
+
+      if (PlySize(property.countType.value()) + offset > size_t(dataEnd - it))
+      {
+        LOG_ERROR("MeshImporter: {} is truncated", path.c_str());
+        return std::nullopt;
+      }
+
+      const int64_t count = ReadPly<int64_t>(it + offset, property.countType.value(), swap);
+      if (p == indicesProperty && count > 2)
+        triangles += size_t(count - 2);
+      offset += PlySize(property.countType.value()) + size_t(std::max<int64_t>(count, 0)) * PlySize(property.type);
+    }
+
+    if (offset > size_t(dataEnd - it))
+    {
+      LOG_ERROR("MeshImporter: {} is truncated", path.c_str());
+      return std::nullopt;
+    }
+    it += offset;
+  }
+
+  if (triangles * 3 >= NO_INDEX)
+  {
+    LOG_ERROR("MeshImporter: {} has too many triangles", path.c_str());
+    return std::nullopt;
+  }
+
+  mesh.indices.resize(triangles * 3);
+  pool.ForEach(blocks.begin(), blocks.end(), [&](FaceBlock &block) {
+    const byte_t *face = block.begin;
+    uint32_t *indices = mesh.indices.data() + block.triangles * 3;
+
+    for (size_t f = 0; f < block.faces; ++f)
+    {
+      for (size_t p = 0; p < faceElement->properties.size(); ++p)
+      {
+        const PlyProperty &property = faceElement->properties[p];
+        if (!property.countType.has_value())
+        {
+          face += PlySize(property.type);
+          continue;
+        }
+
+        const int64_t count = std::max<int64_t>(ReadPly<int64_t>(face, property.countType.value(), swap), 0);
+        face += PlySize(property.countType.value());
+
+        for (int64_t i = 0; p == indicesProperty && i < count; ++i)
+        {
+          const int64_t index = ReadPly<int64_t>(face + i * PlySize(property.type), property.type, swap);
+          block.valid &= index >= 0 && index < int64_t(mesh.vertices.size());
+
+          // fan around the first vertex
+          if (i >= 2)
+          {
+            indices[0] = ReadPly<uint32_t>(face, property.type, swap);
+            indices[1] = ReadPly<uint32_t>(face + (i - 1) * PlySize(property.type), property.type, swap);
+            indices[2] = uint32_t(index);
+            indices += 3;
+          }
+        }
+        face += size_t(count) * PlySize(property.type);
+      }
+    }
+  }, 1);
+
+  if (std::any_of(blocks.begin(), blocks.end(), [](const FaceBlock &block) { return !block.valid; }))
+  {
+    LOG_ERROR("MeshImporter: {} has faces with invalid vertex indices", path.c_str());
+    return std::nullopt;
+  }
+  return mesh;
+}
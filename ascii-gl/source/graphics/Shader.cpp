@@ -1,7 +1,28 @@
 #include "graphics/Shader.hpp"
 
-void Program::Attach(IVertexShader *vertexShader)
+IVertexShader::IVertexShader(Program &parent, size_t varyingCount) : IShader(parent), m_varyingCount(varyingCount)
 {
+  // the fragment quads hold MAX_VARYINGS varyings, the draw calls rely on it
+  if (varyingCount > MAX_VARYINGS)
+    throw InvalidShaderException(std::to_string(varyingCount) + " varyings, " + std::to_string(MAX_VARYINGS) + " at most");
+}
+
+void VertexBatch::Transform(unsigned int attribute, const glm::mat4 &matrix) const
+{
+  if (contiguous && buffer->Streams().Transform(attribute, matrix, indices[0], count, positions))
+    return;
+
+  VertexAttributes attributes;
+  for (size_t i = 0; i < count; ++i)
+  {
+    buffer->Fetch(indices[i], attributes);
+    positions[i] = matrix * (attribute < MAX_VERTEX_ATTRIBS ? attributes[attribute] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+}
+
+void Program::Attach(IVertexShader *vertexShader, uint8_t inputs)
+{
+  vertexShader->m_inputs = inputs;
   m_vertexShader.reset(vertexShader);
 }
 
@@ -15,4 +36,40 @@ bool Program::IsValid()
   return (m_vertexShader && m_fragmentShader);
 }
 
-/// TODO: Implement the layout in/out system (variable interpolation)
+int Program::GetUniformLocation(const std::string_view name)
+{
+  std::map<std::string, int, std::less<>>::const_iterator it;
+
+  it = m_locations.find(name);
+  if (it != m_locations.end())
+    return it->second;
+
+  const int location = int(m_uniforms.size());
+
+  m_uniforms.push_back({ std::string(name), nullptr, 0, 0 });
+  m_locations.emplace(name, location);
+  return location;
+}
+
+Program::UniformSlot &Program::GetSlot(int location)
+{
+  if (location < 0 || size_t(location) >= m_uniforms.size())
+    throw InvalidUniformException("Invalid uniform location", std::to_string(location));
+  return m_uniforms[location];
+}
+
+const Program::UniformSlot &Program::GetSlot(int location) const
+{
+  if (location < 0 || size_t(location) >= m_uniforms.size())
+    throw InvalidUniformException("Invalid uniform location", std::to_string(location));
+  return m_uniforms[location];
+}
+
+void Program::Allocate(UniformSlot &slot, size_t size)
+{
+  const size_t blocks = (size + sizeof(UniformBlock) - 1) / sizeof(UniformBlock);
+
+  slot.offset = m_storage.size() * sizeof(UniformBlock);
+  slot.capacity = blocks * sizeof(UniformBlock);
+  m_storage.resize(m_storage.size() + blocks);
+}
@@ -147,6 +147,28 @@ void TermBuffer::SetPixel(unsigned int x, unsigned int y, uint8_t red, uint8_t g
   inject_digits(position->blue,  uint8_t(blue  * blend));
 }
 
+void TermBuffer::FillSpan(unsigned int x, unsigned int y, unsigned int length, uint32_t color)
+{
+  if (length == 0)
+    return;
+
+  // format the first pixel and copy its escape sequence onto the next ones
+  SetPixel(x, y, color);
+
+  const size_t off = (x * pixel_size) + (y * line_size(m_width));
+  char *first = m_buffer.get() + off;
+
+  for (unsigned int i = 1; i < length; ++i)
+    memcpy(first + (i * pixel_size), first, pixel_size);
+}
+
+void TermBuffer::WriteSpan(unsigned int x, unsigned int y, unsigned int length, const uint32_t *colors)
+{
+  // non virtual calls
+  for (unsigned int i = 0; i < length; ++i)
+    TermBuffer::SetPixel(x + i, y, colors[i]);
+}
+
 void TermBuffer::Resize(unsigned int width, unsigned int height)
 {
   m_width = width;
@@ -156,6 +178,9 @@ void TermBuffer::Resize(unsigned int width, unsigned int height)
   m_lsize = line_size(width);
 
   RecreateBuffer();
+
+  if (!m_depth.Empty())
+    m_depth.Resize(width, height);
 }
 
 void TermBuffer::RecreateBuffer()
@@ -0,0 +1,59 @@
+#include "graphics/VertexLayout.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+template<class T>
+static float ReadComponent(const byte_t *data, unsigned int component, bool normalized)
+{
+  T value;
+  std::memcpy(&value, data + component * sizeof(T), sizeof(T));
+
+  if constexpr (std::is_integral_v<T>)
+  {
+    if (normalized)
+      return std::max(float(value) / float(std::numeric_limits<T>::max()), -1.0f);
+  }
+  return float(value);
+}
+
+template<class T>
+static void ReadAttribute(const byte_t *data, const VertexAttrib &attribute, glm::vec4 &value)
+{
+  for (unsigned int i = 0; i < attribute.count; ++i)
+    value[i] = ReadComponent<T>(data, i, attribute.normalized);
+}
+
+bool VertexLayout::Empty() const
+{
+  return std::none_of(m_attributes.begin(), m_attributes.end(), [](const VertexAttrib &attribute) {
+    return attribute.enabled;
+  });
+}
+
+void VertexLayout::Fetch(const byte_t *vertex, VertexAttributes &attributes) const
+{
+  for (size_t i = 0; i < MAX_VERTEX_ATTRIBS; ++i)
+  {
+    const VertexAttrib &attribute = m_attributes[i];
+    glm::vec4 &value = attributes.values[i];
+
+    value = { 0.0f, 0.0f, 0.0f, 1.0f };
+    if (!attribute.enabled)
+      continue;
+
+    const byte_t *data = vertex + attribute.offset;
+    switch (attribute.type)
+    {
+    case gl::BYTE:           ReadAttribute<int8_t>(data, attribute, value); break;
+    case gl::UNSIGNED_BYTE:  ReadAttribute<uint8_t>(data, attribute, value); break;
+    case gl::SHORT:          ReadAttribute<int16_t>(data, attribute, value); break;
+    case gl::UNSIGNED_SHORT: ReadAttribute<uint16_t>(data, attribute, value); break;
+    case gl::INT:            ReadAttribute<int32_t>(data, attribute, value); break;
+    case gl::UNSIGNED_INT:   ReadAttribute<uint32_t>(data, attribute, value); break;
+    case gl::FLOAT:          ReadAttribute<float>(data, attribute, value); break;
+    }
+  }
+}
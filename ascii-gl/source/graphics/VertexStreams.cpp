@@ -0,0 +1,115 @@
+#include "graphics/VertexStreams.hpp"
+
+#include <algorithm>
+
+#include <immintrin.h>
+
+void VertexStreams::Build(const byte_t *vertices, size_t vertexSize, size_t vertexCount, const VertexLayout &layout)
+{
+  m_vertexCount = vertexCount;
+  m_blocksPerStream = (vertexCount + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  size_t streamCount = 0;
+  for (unsigned int a = 0; a < MAX_VERTEX_ATTRIBS; ++a)
+  {
+    const VertexAttrib &attribute = layout.GetAttribute(a);
+
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+      const bool stored = attribute.enabled && c < attribute.count;
+      m_streams[a * 4 + c] = stored ? (streamCount++) * m_blocksPerStream : NO_STREAM;
+    }
+  }
+
+  m_data.assign(streamCount * m_blocksPerStream, Block{});
+
+  return Update(vertices, vertexSize, 0, vertexCount, layout);
+}
+
+void VertexStreams::Update(const byte_t *vertices, size_t vertexSize, size_t first, size_t end, const VertexLayout &layout)
+{
+  // the conversion of the components is left to the layout
+  VertexAttributes attributes;
+  float *data = m_data.empty() ? nullptr : m_data.front().values;
+
+  for (size_t i = first; i < std::min(end, m_vertexCount); ++i)
+  {
+    layout.Fetch(vertices + i * vertexSize, attributes);
+
+    for (size_t s = 0; s < m_streams.size(); ++s)
+    {
+      if (m_streams[s] != NO_STREAM)
+        data[m_streams[s] * BLOCK_SIZE + i] = attributes.values[s / 4][int(s % 4)];
+    }
+  }
+}
+
+void VertexStreams::Clear()
+{
+  m_vertexCount = 0;
+  m_blocksPerStream = 0;
+  m_data.clear();
+}
+
+const float *VertexStreams::Stream(unsigned int attribute, unsigned int component) const
+{
+  if (Empty() || attribute >= MAX_VERTEX_ATTRIBS || component >= 4 || m_streams[attribute * 4 + component] == NO_STREAM)
+    return nullptr;
+
+  return m_data[m_streams[attribute * 4 + component]].values;
+}
+
+bool VertexStreams::Transform(unsigned int attribute, const glm::mat4 &matrix, size_t first, size_t count, glm::vec4 *positions) const
+{
+  if (first > m_vertexCount || count > m_vertexCount - first)
+    return false;
+
+  const float *components[4];
+  for (unsigned int c = 0; c < 4; ++c)
+    components[c] = Stream(attribute, c);
+
+  if (!components[0])
+    return false;
+
+  // columns[c][r] holds matrix[c][r] in every lane
+  __m128 columns[4][4];
+  for (int c = 0; c < 4; ++c)
+  {
+    for (int r = 0; r < 4; ++r)
+      columns[c][r] = _mm_set1_ps(matrix[c][r]);
+  }
+
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4)
+  {
+    // one component of 4 vertices per register
+    __m128 input[4];
+    for (unsigned int c = 0; c < 4; ++c)
+      input[c] = components[c] ? _mm_loadu_ps(components[c] + first + i) : _mm_set1_ps(c == 3 ? 1.0f : 0.0f);
+
+    __m128 output[4];
+    for (int r = 0; r < 4; ++r)
+    {
+      output[r] = _mm_mul_ps(columns[0][r], input[0]);
+      for (int c = 1; c < 4; ++c)
+        output[r] = _mm_add_ps(output[r], _mm_mul_ps(columns[c][r], input[c]));
+    }
+
+    // back to one vertex per register
+    _MM_TRANSPOSE4_PS(output[0], output[1], output[2], output[3]);
+    for (size_t v = 0; v < 4; ++v)
+      _mm_storeu_ps(&positions[i + v][0], output[v]);
+  }
+
+  for (; i < count; ++i)
+  {
+    glm::vec4 value = { 0.0f, 0.0f, 0.0f, 1.0f };
+    for (unsigned int c = 0; c < 4; ++c)
+    {
+      if (components[c])
+        value[int(c)] = components[c][first + i];
+    }
+    positions[i] = matrix * value;
+  }
+  return true;
+}
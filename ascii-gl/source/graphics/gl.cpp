@@ -2,14 +2,17 @@
 
 #include "graphics/gl.hpp"
 #include "graphics/Context.hpp"
+#include "graphics/Pipeline.hpp"
 #include "graphics/primitives/PrimitiveAssemblers.hpp"
 #include "graphics/primitives/PrimitiveProcessors.hpp"
 #include "graphics/primitives/PrimitiveRenderers.hpp"
 
 #include "Dialogs.hpp"
 
-#include <execution>
 #include <algorithm>
+#include <optional>
+#include <limits>
+#include <type_traits>
 
 namespace gl
 {
@@ -20,18 +23,70 @@ namespace gl
 
   void Clear()
   {
-    Context::Instance()->GetFrameBuffer().Clear();
+    Context &context = *Context::Instance();
+    FrameBuffer &framebuffer = context.GetFrameBuffer();
+
+    framebuffer.Clear();
+
+    DepthBuffer &depth = framebuffer.GetDepthBuffer();
+    if (context.IsEnabled(DEPTH_TEST))
+      depth.Resize(framebuffer.Width(), framebuffer.Height());
+    if (!depth.Empty())
+      depth.Clear(context.GetClearDepth());
+  }
+
+  void ClearDepth(float depth)
+  {
+    return Context::Instance()->SetClearDepth(depth);
+  }
+
+  void Enable(Capability capability)
+  {
+    return Context::Instance()->Enable(capability);
+  }
+
+  void Disable(Capability capability)
+  {
+    return Context::Instance()->Disable(capability);
+  }
+
+  bool IsEnabled(Capability capability)
+  {
+    return Context::Instance()->IsEnabled(capability);
+  }
+
+  void ThreadCount(size_t count)
+  {
+    return Context::Instance()->GetThreadPool().SetThreadCount(count);
+  }
+
+  void GrainSize(size_t grainSize)
+  {
+    return Context::Instance()->GetThreadPool().SetGrainSize(grainSize);
+  }
+
+  void GeometryBudget(size_t bytes)
+  {
+    return Context::Instance()->SetGeometryBudget(bytes);
+  }
+
+  void CullFace(Face face)
+  {
+    return Context::Instance()->SetCullFace(face);
+  }
+
+  void FrontFace(Winding winding)
+  {
+    return Context::Instance()->SetFrontFace(winding);
   }
 
   void CreateBuffers(size_t size, int *buffers)
   {
-    const Context &c = *Context::Instance();
+    Context &c = *Context::Instance();
 
-    int last_buffer = 0;
     for (size_t i = 0; i < size; i++)
     {
-      last_buffer = c.CreateBuffer(last_buffer);
-      buffers[i] = last_buffer;
+      buffers[i] = c.CreateBuffer();
     }
   }
 
@@ -50,6 +105,139 @@ namespace gl
     return Context::Instance()->BindBuffer(bufferId);
   }
 
+  void BindInstanceBuffer(int bufferId)
+  {
+    return Context::Instance()->BindInstanceBuffer(bufferId);
+  }
+
+  void CreateElementBuffers(size_t size, int *buffers)
+  {
+    Context &c = *Context::Instance();
+
+    for (size_t i = 0; i < size; i++)
+    {
+      buffers[i] = c.CreateElementBuffer();
+    }
+  }
+
+  void DeleteElementBuffers(size_t size, int *buffers)
+  {
+    Context &c = *Context::Instance();
+
+    for (size_t i = 0; i < size; i++)
+    {
+      c.DeleteElementBuffer(buffers[i]);
+    }
+  }
+
+  void BindElementBuffer(int bufferId)
+  {
+    return Context::Instance()->BindElementBuffer(bufferId);
+  }
+
+  // bound buffer if it holds at least `offset + count` vertices of `vertexSize` bytes
+  static std::optional<Buffer *> BoundBufferRange(const char *function, size_t offset, size_t count, size_t vertexSize)
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value())
+      return std::nullopt;
+
+    if (buffer.value()->Size() != vertexSize || count > buffer.value()->Count() || offset > buffer.value()->Count() - count)
+    {
+      LOG_ERROR("{}: invalid range [{}, {}) of {} bytes vertices, the buffer holds {} vertices of {} bytes", function, offset,
+                offset + count, vertexSize, buffer.value()->Count(), buffer.value()->Size());
+      return std::nullopt;
+    }
+    return buffer;
+  }
+
+  void BufferSubData(size_t offset, size_t count, const void *data, size_t vertexSize)
+  {
+    std::optional<Buffer *> buffer = BoundBufferRange("BufferSubData", offset, count, vertexSize);
+    if (!buffer.has_value())
+      return;
+
+    buffer.value()->SetRange(offset, count, data);
+  }
+
+  void *MapBuffer(size_t offset, size_t count, size_t vertexSize)
+  {
+    std::optional<Buffer *> buffer = BoundBufferRange("MapBuffer", offset, count, vertexSize);
+    if (!buffer.has_value())
+      return nullptr;
+
+    return buffer.value()->Map(offset, count);
+  }
+
+  void FlushMappedBufferRange(size_t offset, size_t count)
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value())
+      return;
+
+    buffer.value()->Flush(offset, count);
+  }
+
+  void UnmapBuffer()
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value() || !buffer.value()->IsMapActive())
+    {
+      LOG_ERROR("UnmapBuffer: the bound buffer isn't mapped");
+      return;
+    }
+
+    buffer.value()->Unmap();
+  }
+
+  void BufferMesh(const Ref<MeshFile> &mesh)
+  {
+    if (!mesh)
+      return;
+
+    Context &context = *Context::Instance();
+
+    std::optional<Buffer *> buffer = context.GetBoundBuffer();
+    if (buffer.has_value())
+      mesh->MapVertices(*buffer.value());
+
+    std::optional<ElementBuffer *> elements = context.GetBoundElementBuffer();
+    if (elements.has_value())
+      mesh->MapIndices(*elements.value());
+  }
+
+  void VertexAttribPointer(unsigned int index, unsigned int count, AttribType type, bool normalized, size_t offset)
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value())
+      return;
+
+    if (index >= MAX_VERTEX_ATTRIBS || count < 1 || count > 4)
+    {
+      LOG_ERROR("VertexAttribPointer: invalid attribute {} ({} components)", index, count);
+      return;
+    }
+    buffer.value()->SetAttribute(index, { true, offset, count, type, normalized });
+  }
+
+  void DisableVertexAttrib(unsigned int index)
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value() || index >= MAX_VERTEX_ATTRIBS)
+      return;
+
+    buffer.value()->SetAttribute(index, {});
+  }
+
+  void VertexStorage(StorageMode storage)
+  {
+    std::optional<Buffer *> buffer = Context::Instance()->GetBoundBuffer();
+    if (!buffer.has_value())
+      return;
+
+    buffer.value()->SetStorage(storage);
+  }
+
   int CreateProgram()
   {
     return Context::Instance()->CreateProgram();
@@ -73,6 +261,55 @@ namespace gl
     return program.has_value() && program.value()->IsValid();
   }
 
+  int GetUniformLocation(int programId, const std::string_view name)
+  {
+    std::optional<Program *> program = Context::Instance()->GetProgram(programId);
+    if (!program.has_value())
+      return -1;
+
+    return program.value()->GetUniformLocation(name);
+  }
+
+
+  // vertex stage of the generic draw calls, the shader is called through its vtable
+  struct VirtualVertexStage
+  {
+    IVertexShader &shader;
+
+    void Begin() const { shader.Begin(); }
+    void BeginInstance(size_t instance, const Buffer *instances) const { shader.BeginInstance(instance, instances); }
+    void operator()(const VertexBatch &batch) const { shader(batch); }
+  };
+
+  // common part of the generic draw calls
+  static void Draw(RenderMode mode, size_t instanceCount, const Pipeline::DrawIndices &indices)
+  {
+    std::optional<Buffer*> buffer;
+    std::optional<Program*> program;
+
+    Context &context = *Context::Instance();
+    buffer = context.GetBoundBuffer();
+    program = context.GetBoundProgram();
+
+    if (!buffer.has_value() || !program.has_value())
+      return;
+
+    // plain data vertices can only be read through their layout
+    if (!buffer.value()->IsIVertex() && buffer.value()->Layout().Empty())
+    {
+      LOG_ERROR("DrawElements: the bound buffer has no vertex layout");
+      return;
+    }
+
+    IVertexShader &shader = program.value()->GetVertexShader();
+    if (!shader.Reads(buffer.value()->IsIVertex() ? VertexInput::IVERTEX : VertexInput::ATTRIBUTES))
+    {
+      LOG_ERROR("DrawElements: the vertex shader has no operator for the vertices of the bound buffer");
+      return;
+    }
+
+    return Pipeline::Execute(*buffer.value(), mode, instanceCount, indices, shader.VaryingCount(), VirtualVertexStage{ shader });
+  }
 
   void DrawElements(const std::vector<int> &indices)
   {
@@ -92,44 +329,279 @@ namespace gl
 
   void DrawElements(RenderMode mode, size_t indicesCount, const int *indices)
   {
-    std::optional<Buffer*> buffer;
-    std::optional<Program*> program;
+    return DrawElementsInstanced(mode, indicesCount, indices, 1);
+  }
 
-    Context &context = *Context::Instance();
-    buffer = context.GetBoundBuffer();
-    program = context.GetBoundProgram();
+  void DrawElementBuffer(RenderMode mode, size_t count, size_t offset)
+  {
+    return DrawElementBufferInstanced(mode, count, offset, 1);
+  }
 
-    if (!buffer.has_value() || !program.has_value())
+  void DrawElementsInstanced(RenderMode mode, const std::vector<int> &indices, size_t instanceCount)
+  {
+    return DrawElementsInstanced(mode, indices.size(), indices.data(), instanceCount);
+  }
+
+  void DrawElementsInstanced(RenderMode mode, size_t indicesCount, const int *indices, size_t instanceCount)
+  {
+    return Draw(mode, instanceCount, { INT, indices, indicesCount });
+  }
+
+  void DrawElementBufferInstanced(RenderMode mode, size_t count, size_t offset, size_t instanceCount)
+  {
+    std::optional<Pipeline::DrawIndices> indices = Pipeline::BoundElementIndices(count, offset);
+    if (!indices.has_value())
       return;
 
-    std::vector<glm::vec4> &geometryBuffer = context.GetGeometryBuffer();
+    return Draw(mode, instanceCount, indices.value());
+  }
+}
 
-    // Vertex shader
+namespace Pipeline
+{
+  std::optional<DrawIndices> BoundElementIndices(size_t count, size_t offset)
+  {
+    std::optional<ElementBuffer *> elements = Context::Instance()->GetBoundElementBuffer();
+    if (!elements.has_value())
+      return std::nullopt;
+
+    const ElementBuffer &buffer = *elements.value();
+    if (offset > buffer.Count() || count > buffer.Count() - offset)
     {
-      IVertexShader &shader   = program.value()->GetVertexShader();
-      Buffer        &vertices = *buffer.value();
+      LOG_ERROR("DrawElementBuffer: range [{}, {}) out of the bound element buffer ({} indices)", offset, offset + count, buffer.Count());
+      return std::nullopt;
+    }
 
-      glm::vec4 *geometry = context.GetGeometryBuffer(vertices.Count()).data();
+    if (buffer.Type() == gl::UNSIGNED_SHORT)
+      return DrawIndices{ gl::UNSIGNED_SHORT, buffer.Data<uint16_t>(offset), count };
+    return DrawIndices{ gl::UNSIGNED_INT, buffer.Data<uint32_t>(offset), count };
+  }
+
+  bool FetchVertices(const Buffer &vertices, const DrawIndices &indices)
+  {
+    // Only the vertices referenced by the indices are shaded (once each), the geometry buffer is indexed by the remapped indices
+    VertexCache &cache = Context::Instance()->GetVertexCache();
+
+    bool valid = false;
+    switch (indices.type)
+    {
+    case gl::UNSIGNED_SHORT: valid = cache.Build(vertices.Count(), indices.count, static_cast<const uint16_t *>(indices.data)); break;
+    case gl::UNSIGNED_INT:   valid = cache.Build(vertices.Count(), indices.count, static_cast<const uint32_t *>(indices.data)); break;
+    default:                 valid = cache.Build(vertices.Count(), indices.count, static_cast<const int *>(indices.data)); break;
+    }
+
+    if (!valid)
+    {
+      LOG_ERROR("DrawElements: index out of the bound buffer ({} vertices)", vertices.Count());
+      return false;
+    }
+    return true;
+  }
+
+  // the negative indices wrap around, above any vertex count
+  template<class Index>
+  static size_t HighestIndex(const Index *indices, size_t count)
+  {
+    std::make_unsigned_t<Index> highest = 0;
+    for (size_t i = 0; i < count; ++i)
+      highest = std::max(highest, std::make_unsigned_t<Index>(indices[i]));
+    return highest;
+  }
+
+  bool CheckIndices(const Buffer &vertices, const DrawIndices &indices)
+  {
+    size_t highest = 0;
+    switch (indices.type)
+    {
+    case gl::UNSIGNED_SHORT: highest = HighestIndex(static_cast<const uint16_t *>(indices.data), indices.count); break;
+    case gl::UNSIGNED_INT:   highest = HighestIndex(static_cast<const uint32_t *>(indices.data), indices.count); break;
+    default:                 highest = HighestIndex(static_cast<const int *>(indices.data), indices.count); break;
+    }
 
-      std::for_each(
-       #ifndef SINGLE_THREADED
-        std::execution::par,
-       #endif
-        geometry, geometry + vertices.Count(), [geometry, &shader, &vertices](glm::vec4 &pos) {
-          const size_t i = (&pos - geometry);
-          pos = shader(vertices.Vertex(i), i);
+    if (indices.count && highest >= vertices.Count())
+    {
+      LOG_ERROR("DrawElements: index out of the bound buffer ({} vertices)", vertices.Count());
+      return false;
+    }
+    return true;
+  }
+
+  size_t ChunkSize(gl::RenderMode mode, size_t varyingCount)
+  {
+    const size_t budget = Context::Instance()->GetGeometryBudget();
+    if (!budget)
+      return std::numeric_limits<size_t>::max();
+
+    // every index can bring one vertex (position, projection flag, varyings and its vertex cache entries)
+    // and one primitive (assembled, processed and compacted, with the compaction counters),
+    // plus the lookup table of the vertex cache (up to 4 entries per index, see VertexCache::TableSize)
+    const size_t perIndex = sizeof(glm::vec4) + sizeof(uint8_t) + varyingCount * sizeof(float) + 2 * sizeof(unsigned)
+                          + 3 * sizeof(Triangle) + 2 * sizeof(uint32_t)
+                          + 4 * (2 * sizeof(uint32_t) + sizeof(unsigned));
+
+    const size_t size = std::max(MIN_CHUNK_SIZE, budget / perIndex);
+    switch (mode)
+    {
+    // the chunks must hold whole primitives
+    case gl::LINES:          return size - size % 2;
+    case gl::TRIANGLES:      return size - size % 3;
+    // the chunks overlap by 2 indices, they must start on an even index to keep the winding of the strip
+    case gl::TRIANGLE_STRIP: return size - size % 2;
+    default:                 return size;
+    }
+  }
+
+  // number of indices between the start of two chunks, the chunks of the connected primitives overlap
+  static size_t ChunkStep(gl::RenderMode mode, size_t chunkSize)
+  {
+    switch (mode)
+    {
+    case gl::LINE_LOOP:
+    case gl::LINE_STRIP:     return chunkSize - 1;
+    case gl::TRIANGLE_STRIP:
+    case gl::TRIANGLE_FAN:   return chunkSize - 2;
+    default:                 return chunkSize;
+    }
+  }
+
+  size_t ChunkCount(gl::RenderMode mode, size_t indicesCount, size_t chunkSize)
+  {
+    if (indicesCount <= chunkSize)
+      return 1;
+
+    const size_t step = ChunkStep(mode, chunkSize);
+    return 1 + (indicesCount - chunkSize + step - 1) / step;
+  }
+
+  // copies `count` indices from `first` at the end of `out`
+  static void CopyIndices(const DrawIndices &indices, size_t first, size_t count, std::vector<uint32_t> &out)
+  {
+    switch (indices.type)
+    {
+    case gl::UNSIGNED_SHORT: { const uint16_t *data = static_cast<const uint16_t *>(indices.data) + first; out.insert(out.end(), data, data + count); break; }
+    case gl::UNSIGNED_INT:   { const uint32_t *data = static_cast<const uint32_t *>(indices.data) + first; out.insert(out.end(), data, data + count); break; }
+    // negative indices wrap around and are rejected by the vertex cache all the same
+    default:                 { const int      *data = static_cast<const int      *>(indices.data) + first; out.insert(out.end(), data, data + count); break; }
+    }
+  }
+
+  std::optional<gl::RenderMode> FetchChunk(const Buffer &vertices, gl::RenderMode mode, const DrawIndices &indices, size_t chunk, size_t chunkSize)
+  {
+    const size_t chunkCount = ChunkCount(mode, indices.count, chunkSize);
+    if (chunkCount == 1)
+      return FetchVertices(vertices, indices) ? std::optional(mode) : std::nullopt;
+
+    const size_t indexSize = indices.type == gl::UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+    const size_t first = chunk * ChunkStep(mode, chunkSize);
+    const size_t count = std::min(chunkSize, indices.count - first);
+
+    DrawIndices range = { indices.type, static_cast<const byte_t *>(indices.data) + first * indexSize, count };
+    gl::RenderMode chunkMode = mode;
+
+    // the fans and the loops need an index that isn't part of the chunk: the center of the fan, the start of the loop
+    std::vector<uint32_t> &scratch = Context::Instance()->GetChunkIndices();
+    if (mode == gl::TRIANGLE_FAN)
+    {
+      // the chunk is made of the center followed by the rim indices [first + 1, first + chunkSize)
+      scratch.clear();
+      CopyIndices(indices, 0, 1, scratch);
+      CopyIndices(indices, first + 1, std::min(chunkSize - 1, indices.count - first - 1), scratch);
+
+      range = { gl::UNSIGNED_INT, scratch.data(), scratch.size() };
+    }
+    else if (mode == gl::LINE_LOOP)
+    {
+      // drawn as strips, the last one closes the loop
+      chunkMode = gl::LINE_STRIP;
+      if (chunk + 1 == chunkCount)
+      {
+        scratch.clear();
+        CopyIndices(indices, first, count, scratch);
+        CopyIndices(indices, 0, 1, scratch);
+
+        range = { gl::UNSIGNED_INT, scratch.data(), scratch.size() };
+      }
+    }
+
+    if (!FetchVertices(vertices, range))
+      return std::nullopt;
+    return chunkMode;
+  }
+
+  std::vector<VertexBatch> &PrepareBatches(const Buffer &vertices, size_t varyingCount, size_t instance, const Buffer *instances)
+  {
+    Context &context = *Context::Instance();
+
+    const std::vector<unsigned int> &referenced = context.GetVertexCache().Vertices();
+    glm::vec4 *geometry = context.GetGeometryBuffer(referenced.size()).data();
+    context.GetProjectedVertices(referenced.size());
+    float *varyings = context.GetVaryingBuffer(referenced.size(), varyingCount).data();
+
+    // the vertices are split in batches that are shaded in parallel
+    std::vector<VertexBatch> &batches = context.GetVertexBatches();
+    batches.clear();
+
+    for (size_t first = 0; first < referenced.size(); first += VERTEX_BATCH_SIZE)
+    {
+      const unsigned int *indices = referenced.data() + first;
+      const size_t count = std::min(VERTEX_BATCH_SIZE, referenced.size() - first);
+
+      size_t consecutive = 1;
+      while (consecutive < count && indices[consecutive] == indices[0] + consecutive)
+        ++consecutive;
+
+      batches.push_back({
+        &vertices,
+        indices,
+        count,
+        geometry + first,
+        varyings + first * varyingCount,
+        instance,
+        instances,
+        consecutive == count
       });
     }
+    return batches;
+  }
+
+  void ProjectVertices(const VertexBatch &batch)
+  {
+    Context &context = *Context::Instance();
+
+    const glm::vec4 viewport = context.GetViewport();
+    uint8_t *projected = context.GetProjectedVertices().data() + (batch.positions - context.GetGeometryBuffer().data());
+
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+      projected[i] = PrimitiveProcessor::IsInside(batch.positions[i]);
+      if (projected[i])
+        PrimitiveProcessor::ToScreenSpace(batch.positions[i], viewport);
+    }
+  }
+
+  void DrawPrimitives(gl::RenderMode mode, size_t instance, size_t instanceCount)
+  {
+    Context &context = *Context::Instance();
 
     //Primitives assembly
     {
-      std::vector<glm::vec4> &geometryBuffer = context.GetGeometryBuffer();
+      // the processing below consumes the primitive buffer, so the instanced draws keep the assembled primitives aside
       PrimitiveBuffer &primitives = context.GetPrimitiveBuffer();
+      PrimitiveBuffer &assembled = instanceCount > 1 ? context.GetAssembledPrimitiveBuffer() : primitives;
+
+      // the indices are the same for every instance
+      if (instance == 0)
+      {
+        const std::vector<unsigned int> &indices = context.GetVertexCache().Indices();
 
-      primitives.Clear();
+        assembled.Clear();
 
-      LOG_TRACE("Assembling Primitives:");
-      PrimitiveAssembler::AssemblePrimitive(mode, primitives, indicesCount, indices);
+        LOG_TRACE("Assembling Primitives:");
+        PrimitiveAssembler::AssemblePrimitive(mode, assembled, indices.size(), indices.data());
+      }
+
+      if (&assembled != &primitives)
+        primitives.CopyFrom(assembled);
     }
 
     LOG_TRACE("Process Primitives:");
@@ -138,36 +610,17 @@ namespace gl
       // geometry shader runs here
       ///TODO: implement geometry shader ?
 
-      // clip the vertices
+      // clip the vertices, and convert the ones the vertex stage left in clip space to screen space
       PrimitiveProcessor::ProcessPrimitives(mode, context.GetPrimitiveBuffer());
 
-      // convert from clip space to normalized device coordinates and then to screen space
-      const glm::vec4 viewport = context.GetViewport();
-      std::for_each(
-       #ifndef SINGLE_THREADED
-        std::execution::par,
-       #endif
-        geometryBuffer.data(),
-        geometryBuffer.data() + geometryBuffer.size(),
-        [&context, &viewport](glm::vec4 &pos) {
-          // perspective division
-          const float inv_w = 1.0f / pos.w;
-          pos *= inv_w;
-          pos.w = inv_w;
-
-          // viewport transform
-          pos.x = ( pos.x + 1.0f) * (0.5f * viewport.z) + viewport.x;
-          pos.y = (-pos.y + 1.0f) * (0.5f * viewport.w) + viewport.y;
-      });
+      // remove the triangles that can't produce any pixel
+      PrimitiveProcessor::CullPrimitives(mode, context.GetPrimitiveBuffer());
     }
 
     // draw the primitives
     {
-      /// TODO: implement the rasterizer step
-      PrimitiveRenderer::RenderPrimitives(context.GetPrimitiveBuffer());
+      PrimitiveRenderer::RenderPrimitives(mode, context.GetPrimitiveBuffer());
     }
-
-    return;
   }
 }
 
@@ -4,7 +4,7 @@
 
 namespace PrimitiveAssembler
 {
-  using AssembleFunction = void (*)(PrimitiveBuffer &, size_t, const int *);
+  using AssembleFunction = void (*)(PrimitiveBuffer &, size_t, const unsigned int *);
 
   static constexpr frozen::map<gl::RenderMode, AssembleFunction, 7> functions = {
     { gl::POINTS, AssemblePoints },
@@ -18,7 +18,7 @@ namespace PrimitiveAssembler
     { gl::TRIANGLE_FAN,   AssembleTriangleFan   },
   };
 
-  void AssemblePoints(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssemblePoints(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     if (indicesCount == 0)
       return;
@@ -28,13 +28,13 @@ namespace PrimitiveAssembler
     // geometry creation
     for (size_t i = 0; i < indicesCount; i++)
     {
-      const unsigned index = reinterpret_cast<const unsigned *>(indices)[i];
+      const unsigned index = indices[i];
 
       primitives.Insert<Point>(index);
     }
   }
 
-  void AssembleLines(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleLines(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     indicesCount -= (indicesCount % 2);
 
@@ -43,14 +43,14 @@ namespace PrimitiveAssembler
 
     for (size_t i = 0; i < indicesCount; i += 2)
     {
-      const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[i + 0];
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i + 1];
+      const unsigned i1 = indices[i + 0];
+      const unsigned i2 = indices[i + 1];
 
       primitives.Insert<Line>(i1, i2);
     }
   }
 
-  void AssembleLineLoop(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleLineLoop(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     if (indicesCount < 2)
       return;
@@ -63,14 +63,14 @@ namespace PrimitiveAssembler
 
     for (size_t i = 1; i <= indicesCount; ++i)
     {
-      const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[i - 1];
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i % indicesCount];
+      const unsigned i1 = indices[i - 1];
+      const unsigned i2 = indices[i % indicesCount];
 
       primitives.Insert<Line>(i1, i2);
     }
   }
 
-  void AssembleLineStrip(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleLineStrip(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     if (indicesCount < 2)
       return;
@@ -80,14 +80,14 @@ namespace PrimitiveAssembler
 
     for (size_t i = 1; i < indicesCount; ++i)
     {
-      const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[i - 1];
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i - 0];
+      const unsigned i1 = indices[i - 1];
+      const unsigned i2 = indices[i - 0];
 
       primitives.Insert<Line>(i1, i2);
     }
   }
 
-  void AssembleTriangles(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleTriangles(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     indicesCount -= (indicesCount % 3);
 
@@ -96,15 +96,15 @@ namespace PrimitiveAssembler
 
     for (size_t i = 0; i < indicesCount; i += 3)
     {
-      const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[i + 0];
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i + 1];
-      const unsigned i3 = reinterpret_cast<const unsigned *>(indices)[i + 2];
+      const unsigned i1 = indices[i + 0];
+      const unsigned i2 = indices[i + 1];
+      const unsigned i3 = indices[i + 2];
 
       primitives.Insert<Triangle>(i1, i2, i3);
     }
   }
 
-  void AssembleTriangleStrip(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleTriangleStrip(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     if (indicesCount < 3)
       return;
@@ -114,15 +114,18 @@ namespace PrimitiveAssembler
 
     for (size_t i = 2; i < indicesCount; ++i)
     {
-      const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[i - 2];
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i - 1];
-      const unsigned i3 = reinterpret_cast<const unsigned *>(indices)[i - 0];
+      // every other triangle of the strip has its first two vertices swapped to keep the same winding order
+      const size_t odd = (i % 2);
+
+      const unsigned i1 = indices[i - 2 + odd];
+      const unsigned i2 = indices[i - 1 - odd];
+      const unsigned i3 = indices[i - 0];
 
       primitives.Insert<Triangle>(i1, i2, i3);
     }
   }
 
-  void AssembleTriangleFan(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssembleTriangleFan(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     if (indicesCount < 3)
       return;
@@ -130,18 +133,18 @@ namespace PrimitiveAssembler
     /// TODO: change this loop so it's primitive based
     primitives.Reserve<Triangle>(indicesCount - 2);
 
-    const unsigned i1 = reinterpret_cast<const unsigned *>(indices)[0];
+    const unsigned i1 = indices[0];
     //const glm::vec4 &p1 = geometryBuffer[i1];
     for (size_t i = 2; i < indicesCount; ++i)
     {
-      const unsigned i2 = reinterpret_cast<const unsigned *>(indices)[i - 1];
-      const unsigned i3 = reinterpret_cast<const unsigned *>(indices)[i - 0];
+      const unsigned i2 = indices[i - 1];
+      const unsigned i3 = indices[i - 0];
 
       primitives.Insert<Triangle>(i1, i2, i3);
     }
   }
   
-  void AssemblePrimitive(gl::RenderMode mode, PrimitiveBuffer &primitives, size_t indicesCount, const int *indices)
+  void AssemblePrimitive(gl::RenderMode mode, PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices)
   {
     return functions.at(mode)(primitives, indicesCount, indices);
   }
@@ -5,15 +5,15 @@
 
 namespace PrimitiveAssembler
 {
-  void AssemblePoints(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
+  void AssemblePoints(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
 
-  void AssembleLines(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
-  void AssembleLineLoop(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
-  void AssembleLineStrip(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
+  void AssembleLines(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
+  void AssembleLineLoop(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
+  void AssembleLineStrip(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
 
-  void AssembleTriangles(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
-  void AssembleTriangleStrip(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
-  void AssembleTriangleFan(PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
+  void AssembleTriangles(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
+  void AssembleTriangleStrip(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
+  void AssembleTriangleFan(PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
 
-  void AssemblePrimitive(gl::RenderMode mode, PrimitiveBuffer &primitives, size_t indicesCount, const int *indices);
+  void AssemblePrimitive(gl::RenderMode mode, PrimitiveBuffer &primitives, size_t indicesCount, const unsigned int *indices);
 }
\ No newline at end of file
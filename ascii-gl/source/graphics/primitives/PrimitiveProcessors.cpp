@@ -6,10 +6,8 @@
 #include "graphics/Context.hpp"
 
 #include <cstdint>
-
-using iter = PrimitiveBuffer::iterator;
-template<class Primitive>
-using piter = PrimitiveBuffer::piterator<Primitive>;
+#include <algorithm>
+#include <numeric>
 
 constexpr uint8_t CENTER_REGION = 0;
 constexpr uint8_t NEAR_REGION = BIT(0);
@@ -19,6 +17,14 @@ constexpr uint8_t DOWN_REGION = BIT(3);
 constexpr uint8_t RIGHT_REGION = BIT(4);
 constexpr uint8_t LEFT_REGION = BIT(5);
 
+// Triangles are only clipped against the sides of the screen when they cross this guard band
+// (expressed as a multiple of the clipping volume). Anything inside of it is left to the rasterizer
+// which only walks the pixels of the viewport anyway.
+constexpr float GUARD_BAND = 32.0f;
+
+// Maximum number of vertices of a triangle clipped by the near plane and the 4 sides of the guard band
+constexpr size_t MAX_CLIPPED_VERTICES = 3 + 5;
+
 constexpr uint8_t GetRegions(const glm::vec4 &pos)
 {
   uint8_t regions = CENTER_REGION;
@@ -33,41 +39,126 @@ constexpr uint8_t GetRegions(const glm::vec4 &pos)
   else if (pos.y >= pos.w)
     regions |= TOP_REGION;
 
+  // the near plane is at z = -w (OpenGL convention, also used by glm projections)
   if (pos.z < -pos.w)
-    regions |= FAR_REGION;
+    regions |= NEAR_REGION;
   else if (pos.z >= pos.w)
+    regions |= FAR_REGION;
+
+  return regions;
+};
+
+// Same as GetRegions but using the guard band for the sides, the far plane is ignored
+constexpr uint8_t GetClipRegions(const glm::vec4 &pos)
+{
+  uint8_t regions = CENTER_REGION;
+
+  if (pos.x < -GUARD_BAND * pos.w)
+    regions |= LEFT_REGION;
+  else if (pos.x > GUARD_BAND * pos.w)
+    regions |= RIGHT_REGION;
+
+  if (pos.y < -GUARD_BAND * pos.w)
+    regions |= DOWN_REGION;
+  else if (pos.y > GUARD_BAND * pos.w)
+    regions |= TOP_REGION;
+
+  if (pos.z < -pos.w)
     regions |= NEAR_REGION;
 
   return regions;
+}
+
+// Signed distance of a vertex to one of the clipping planes, positive on the visible side
+constexpr float PlaneDistance(uint8_t plane, const glm::vec4 &pos)
+{
+  switch (plane)
+  {
+  case NEAR_REGION:  return pos.z + pos.w;
+  case LEFT_REGION:  return pos.x + GUARD_BAND * pos.w;
+  case RIGHT_REGION: return GUARD_BAND * pos.w - pos.x;
+  case DOWN_REGION:  return pos.y + GUARD_BAND * pos.w;
+  case TOP_REGION:   return GUARD_BAND * pos.w - pos.y;
+  default:           return 0.0f;
+  }
+}
+
+// Vertex of a polygon being clipped, new vertices are only added to the geometry buffer once the clipping is done
+struct ClipVertex
+{
+  static constexpr unsigned NEW_VERTEX = ~0u;
+
+  glm::vec4 pos;
+  unsigned index;
+  glm::vec3 weights; // relative to the vertices of the triangle being clipped
 };
 
+// Clips a convex polygon against one plane (Sutherland-Hodgman), returns the new vertex count
+static size_t ClipPolygon(uint8_t plane, const ClipVertex *in, size_t count, ClipVertex *out)
+{
+  size_t outCount = 0;
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const ClipVertex &current = in[i];
+    const ClipVertex &next = in[(i + 1) % count];
+
+    const float d1 = PlaneDistance(plane, current.pos);
+    const float d2 = PlaneDistance(plane, next.pos);
+
+    if (d1 >= 0.0f)
+      out[outCount++] = current;
+
+    // the edge crosses the plane
+    if ((d1 >= 0.0f) != (d2 >= 0.0f))
+    {
+      const float t = d1 / (d1 - d2);
+      out[outCount++] = {
+        current.pos + (next.pos - current.pos) * t,
+        ClipVertex::NEW_VERTEX,
+        current.weights + (next.weights - current.weights) * t
+      };
+    }
+  }
+  return outCount;
+}
+
 namespace PrimitiveProcessor
 {
   // Removes points that are outside of the clipping volume
-  iter ProcessPoint(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, piter<Point> point)
+  uint32_t ProcessPoint(const ClipGeometry &geometryBuffer, uint32_t /*idx*/, const Point &point, ClipResults<Point> & /*results*/)
   {
-    const glm::vec4 &pos = geometryBuffer[point->indices[0]];
+    // already known to be inside
+    if (geometryBuffer.Projected(point.indices[0]))
+      return 1;
+
+    const glm::vec4 pos = geometryBuffer[point.indices[0]];
 
     if (GetRegions(pos) != CENTER_REGION)
     {
       LOG_TRACE("  Point = {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }} [PRUNED]", pos.x, pos.y, pos.z, pos.w);
-      return primitives.Erase(point);
+      return 0;
     }
 
     LOG_TRACE("  Point = {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }}", pos.x, pos.y, pos.z, pos.w);
-    return point.next();
+    return 1;
   }
 
   // Clip the line inside of the clipping volume using 3D versions of the following algorithms:
   // CohenSutherland algorithm (for complete line clipping and early accepting)
   //   https://en.wikipedia.org/wiki/Cohen%E2%80%93Sutherland_algorithm
   //   https://www.mdpi.com/1999-4893/16/4/201
+  // Liang-Barsky algorithm (for the parametric clipping of the remaining lines)
+  //   https://en.wikipedia.org/wiki/Liang%E2%80%93Barsky_algorithm
   //
-  // 
-  iter ProcessLine(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, piter<Line> line)
+  // clipped end points are added as new vertices so the original vertices stay untouched
+  uint32_t ProcessLine(const ClipGeometry &geometryBuffer, uint32_t idx, const Line &line, ClipResults<Line> &results)
   {
-    glm::vec4 p1 = geometryBuffer[line->indices[0]];
-    glm::vec4 p2 = geometryBuffer[line->indices[1]];
+    if (geometryBuffer.Projected(line.indices[0]) && geometryBuffer.Projected(line.indices[1]))
+      return 1;
+
+    const glm::vec4 p1 = geometryBuffer[line.indices[0]];
+    const glm::vec4 p2 = geometryBuffer[line.indices[1]];
 
     const uint8_t p1_regions = GetRegions(p1);
     const uint8_t p2_regions = GetRegions(p2);
@@ -81,7 +172,7 @@ namespace PrimitiveProcessor
         p1.x, p1.y, p1.z, p1.w,
         p2.x, p2.y, p2.z, p2.w
       );
-      return primitives.Erase(line);
+      return 0;
     }
 
     if ((p1_regions | p2_regions) == CENTER_REGION) // line is entirely inside of the screen
@@ -93,47 +184,363 @@ namespace PrimitiveProcessor
         p1.x, p1.y, p1.z, p1.w,
         p2.x, p2.y, p2.z, p2.w
       );
-      return line.next();
+      return 1;
     }
 
     // line needs to be cliped
+    // distances of both end points to each plane of the clipping volume (positive on the inside)
+    const float p1_distances[6] = { p1.w + p1.x, p1.w - p1.x, p1.w + p1.y, p1.w - p1.y, p1.w + p1.z, p1.w - p1.z };
+    const float p2_distances[6] = { p2.w + p2.x, p2.w - p2.x, p2.w + p2.y, p2.w - p2.y, p2.w + p2.z, p2.w - p2.z };
+
+    // parametric range [t0, t1] of the line that is inside of the clipping volume
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+
+    for (int i = 0; i < 6; ++i)
+    {
+      const float d1 = p1_distances[i];
+      const float d2 = p2_distances[i];
+
+      if (d1 < 0.0f && d2 < 0.0f)
+      {
+        t0 = 1.0f;
+        t1 = 0.0f;
+        break;
+      }
+
+      if (d1 < 0.0f)      // entering the plane
+        t0 = std::max(t0, d1 / (d1 - d2));
+      else if (d2 < 0.0f) // leaving the plane
+        t1 = std::min(t1, d1 / (d1 - d2));
+    }
+
+    if (t0 > t1) // line only crosses the outer regions
+    {
+      LOG_TRACE("  Line = [\n"
+        "    {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }}\n"
+        "    {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }}\n"
+        "  ] [PRUNED]",
+        p1.x, p1.y, p1.z, p1.w,
+        p2.x, p2.y, p2.z, p2.w
+      );
+      return 0;
+    }
+
+    LOG_TRACE("  Line = [\n"
+      "    {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }}\n"
+      "    {{ {:5.2}, {:5.2}, {:5.2}, {:5.2} }}\n"
+      "  ] [CLIPPED] to [{:4.2}, {:4.2}]",
+      p1.x, p1.y, p1.z, p1.w,
+      p2.x, p2.y, p2.z, p2.w,
+      t0, t1
+    );
+
+    const glm::vec4 delta = p2 - p1;
+    Line clipped = line;
+    {
+      std::lock_guard<std::mutex> lock(results.mutex);
+
+      const std::array<unsigned, 3> sources = { line.indices[0], line.indices[1], line.indices[1] };
+
+      if (t0 > 0.0f)
+        clipped.indices[0] = results.AddVertex(p1 + delta * t0, sources, { 1.0f - t0, t0, 0.0f });
+      if (t1 < 1.0f)
+        clipped.indices[1] = results.AddVertex(p1 + delta * t1, sources, { 1.0f - t1, t1, 0.0f });
+
+      results.primitives.push_back({ idx, 0, clipped });
+    }
+    return 1 | CLIPPED;
+  }
+
+  // Clip the triangle inside of the clipping volume in homogeneous space:
+  // - triangles entirely outside of one of the planes are rejected
+  // - triangles inside of the volume or of the guard band are accepted as is
+  // - the others are clipped (Sutherland-Hodgman) against the near plane and the crossed guard band planes only,
+  //   the resulting polygon is split into a triangle fan
+  uint32_t ProcessTriangle(const ClipGeometry &geometryBuffer, uint32_t idx, const Triangle &triangle, ClipResults<Triangle> &results)
+  {
+    // every vertex was found inside of the clipping volume by the vertex stage
+    if (geometryBuffer.Projected(triangle.indices[0]) && geometryBuffer.Projected(triangle.indices[1]) && geometryBuffer.Projected(triangle.indices[2]))
+      return 1;
+
+    const glm::vec4 p1 = geometryBuffer[triangle.indices[0]];
+    const glm::vec4 p2 = geometryBuffer[triangle.indices[1]];
+    const glm::vec4 p3 = geometryBuffer[triangle.indices[2]];
+
+    const uint8_t p1_regions = GetRegions(p1);
+    const uint8_t p2_regions = GetRegions(p2);
+    const uint8_t p3_regions = GetRegions(p3);
+
+    if (p1_regions & p2_regions & p3_regions) // triangle is entirely outside of the screen
+    {
+      LOG_TRACE("  Triangle = [ {}, {}, {} ] [PRUNED]", triangle.indices[0], triangle.indices[1], triangle.indices[2]);
+      return 0;
+    }
 
+    if ((p1_regions | p2_regions | p3_regions) == CENTER_REGION) // triangle is entirely inside of the screen
+    {
+      LOG_TRACE("  Triangle = [ {}, {}, {} ] [ACCEPTED]", triangle.indices[0], triangle.indices[1], triangle.indices[2]);
+      return 1;
+    }
+
+    const uint8_t clip_regions = GetClipRegions(p1) | GetClipRegions(p2) | GetClipRegions(p3);
+    if (clip_regions == CENTER_REGION) // triangle is inside of the guard band
+    {
+      LOG_TRACE("  Triangle = [ {}, {}, {} ] [GUARD BAND]", triangle.indices[0], triangle.indices[1], triangle.indices[2]);
+      return 1;
+    }
+
+    // triangle needs to be clipped
+    ClipVertex buffers[2][MAX_CLIPPED_VERTICES] = {{
+      { p1, triangle.indices[0], { 1.0f, 0.0f, 0.0f } },
+      { p2, triangle.indices[1], { 0.0f, 1.0f, 0.0f } },
+      { p3, triangle.indices[2], { 0.0f, 0.0f, 1.0f } },
+    }};
+
+    size_t count = 3;
+    int current = 0;
+
+    for (const uint8_t plane : { NEAR_REGION, LEFT_REGION, RIGHT_REGION, DOWN_REGION, TOP_REGION })
+    {
+      if (!(clip_regions & plane))
+        continue;
+
+      count = ClipPolygon(plane, buffers[current], count, buffers[1 - current]);
+      current = 1 - current;
+
+      if (count < 3)
+        break;
+    }
+
+    if (count < 3)
+    {
+      LOG_TRACE("  Triangle = [ {}, {}, {} ] [PRUNED]", triangle.indices[0], triangle.indices[1], triangle.indices[2]);
+      return 0;
+    }
+
+    LOG_TRACE("  Triangle = [ {}, {}, {} ] [CLIPPED] into {} triangles", triangle.indices[0], triangle.indices[1], triangle.indices[2], count - 2);
+
+    ClipVertex *polygon = buffers[current];
+    {
+      std::lock_guard<std::mutex> lock(results.mutex);
+
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (polygon[i].index == ClipVertex::NEW_VERTEX)
+          polygon[i].index = results.AddVertex(polygon[i].pos, triangle.indices, polygon[i].weights);
+      }
 
-    return line.next();
+      for (uint32_t i = 2; i < count; ++i)
+        results.primitives.push_back({ idx, i - 2, Triangle({ polygon[0].index, polygon[i - 1].index, polygon[i].index }) });
+    }
+    return uint32_t(count - 2) | CLIPPED;
   }
 
-  iter ProcessTriangle(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, piter<Triangle> triangle)
+  // Parallel stream compaction of the primitive buffer (mark, prefix sum, compact):
+  // `process(idx, primitive)` returns how many primitives each primitive results in, the kept primitives are
+  // copied in order to the output buffer which is then swapped with `primitives`
+  template<class Primitive, class Func>
+  static void CompactPrimitives(PrimitiveBuffer &primitives, Func process, const ClipResults<Primitive> *results = nullptr)
   {
-    return triangle.next();
+    const size_t count = primitives.Size();
+    if (count == 0)
+      return;
+
+    Context &context = *Context::Instance();
+
+    std::vector<uint32_t> &counts  = context.GetPrimitiveCounts();
+    std::vector<uint32_t> &offsets = context.GetPrimitiveOffsets();
+    counts.resize(count);
+    offsets.resize(count);
+
+    ThreadPool &pool = context.GetThreadPool();
+    const Primitive *input = &*primitives.pbegin<Primitive>();
+
+    // mark: how many primitives each input primitive results in
+    pool.ParallelFor(count, [&counts, input, &process](size_t begin, size_t end) {
+      for (size_t idx = begin; idx < end; ++idx)
+        counts[idx] = process(uint32_t(idx), input[idx]);
+    });
+
+    // prefix sum: where each input primitive is written in the output buffer.
+    // Every block is summed, then scanned from the sum of the blocks before it
+    {
+      const size_t blockSize = std::max(pool.GrainSize(), (count + pool.ThreadCount() - 1) / pool.ThreadCount());
+      const size_t blockCount = (count + blockSize - 1) / blockSize;
+
+      std::vector<uint32_t> &sums = context.GetPrimitiveBlockSums();
+      sums.resize(blockCount);
+
+      pool.ParallelFor(blockCount, [&counts, &sums, blockSize, count](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+          uint32_t sum = 0;
+          for (size_t idx = block * blockSize; idx < std::min(count, (block + 1) * blockSize); ++idx)
+            sum += counts[idx] & ~CLIPPED;
+          sums[block] = sum;
+        }
+      }, 1);
+
+      std::exclusive_scan(sums.begin(), sums.end(), sums.begin(), uint32_t(0));
+
+      pool.ParallelFor(blockCount, [&counts, &offsets, &sums, blockSize, count](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; ++block)
+        {
+          uint32_t offset = sums[block];
+          for (size_t idx = block * blockSize; idx < std::min(count, (block + 1) * blockSize); ++idx)
+          {
+            offsets[idx] = offset;
+            offset += counts[idx] & ~CLIPPED;
+          }
+        }
+      }, 1);
+    }
+
+    PrimitiveBuffer &output = context.GetPrimitiveOutputBuffer();
+    output.Resize<Primitive>(offsets.back() + (counts.back() & ~CLIPPED));
+
+    Primitive *out = &*output.pbegin<Primitive>();
+
+    // compact: copy the accepted primitives in the output buffer
+    pool.ParallelFor(count, [&counts, &offsets, input, out](size_t begin, size_t end) {
+      for (size_t idx = begin; idx < end; ++idx)
+      {
+        if (counts[idx] == 1)
+          out[offsets[idx]] = input[idx];
+      }
+    });
+
+    // the clipped primitives only concern the (few) primitives that were crossing the clipping planes
+    if (results)
+    {
+      for (const typename ClipResults<Primitive>::Clipped &clipped : results->primitives)
+        out[offsets[clipped.source] + clipped.rank] = clipped.primitive;
+    }
+
+    primitives.Swap(output);
   }
 
-  iter ProcessPrimitive(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, iter primitive)
+  // Computes the varyings of the vertices created by the clipping from the ones of their source vertices
+  template<class Primitive>
+  static void InterpolateVaryings(std::vector<float> &varyingBuffer, size_t varyingCount, const ClipResults<Primitive> &results)
   {
-    switch (primitive->vertexCount)
-    {
-    case 1:
-      return ProcessPoint(geometryBuffer, primitives, piter<Point>(primitive));
-    case 2:
-      return ProcessLine(geometryBuffer, primitives, piter<Line>(primitive));
-    case 3:
-      return ProcessTriangle(geometryBuffer, primitives, piter<Triangle>(primitive));
-    default:
-      LOG_CRITICAL("Critical error: Unsupported primitive type encountered !");
-      dial::Critical("Unsupported primitive type !");
+    varyingBuffer.resize((results.firstVertex + results.vertices.size()) * varyingCount);
+
+    float *varyings = varyingBuffer.data();
+    for (size_t i = 0; i < results.sources.size(); ++i)
+    {
+      const typename ClipResults<Primitive>::Source &source = results.sources[i];
+
+      const float *v1 = varyings + source.indices[0] * varyingCount;
+      const float *v2 = varyings + source.indices[1] * varyingCount;
+      const float *v3 = varyings + source.indices[2] * varyingCount;
+      float *out = varyings + (results.firstVertex + i) * varyingCount;
+
+      for (size_t v = 0; v < varyingCount; ++v)
+        out[v] = v1[v] * source.weights[0] + v2[v] * source.weights[1] + v3[v] * source.weights[2];
     }
-    return primitive + 1;
+  }
+
+  template<class Primitive>
+  static void ProcessPrimitives(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, ProcessFunction<Primitive> function)
+  {
+    Context &context = *Context::Instance();
+    std::vector<uint8_t> &projected = context.GetProjectedVertices();
+
+    ClipResults<Primitive> results;
+    results.firstVertex = geometryBuffer.size();
+
+    const ClipGeometry geometry = { geometryBuffer.data(), projected.data(), context.GetViewport() };
+    CompactPrimitives<Primitive>(primitives, [&geometry, &results, function](uint32_t idx, const Primitive &primitive) {
+      return function(geometry, idx, primitive, results);
+    }, &results);
+
+    // the geometry buffer is only grown once nobody reads it anymore
+    geometryBuffer.insert(geometryBuffer.end(), results.vertices.begin(), results.vertices.end());
+    projected.resize(geometryBuffer.size(), false);
+
+    if (context.GetVaryingCount())
+      InterpolateVaryings(context.GetVaryingBuffer(), context.GetVaryingCount(), results);
+
+    // fix-up of the vertices left in clip space by the vertex stage and of the ones created by the clipping
+    const glm::vec4 viewport = context.GetViewport();
+    glm::vec4 *positions = geometryBuffer.data();
+    context.GetThreadPool().ParallelFor(geometryBuffer.size(), [positions, &projected, &viewport](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+        if (!projected[i])
+          ToScreenSpace(positions[i], viewport);
+      }
+    });
   }
 
   void ProcessPrimitives(gl::RenderMode mode, PrimitiveBuffer &primitives)
   {
     std::vector<glm::vec4> &geometryBuffer = Context::Instance()->GetGeometryBuffer();
 
-    iter it = primitives.begin();
-
-    while (it != primitives.end())
+    switch (mode)
     {
-      it = ProcessPrimitive(geometryBuffer, primitives, it);
+    case gl::POINTS:
+      return ProcessPrimitives<Point>(geometryBuffer, primitives, ProcessPoint);
+
+    case gl::LINES:
+    case gl::LINE_LOOP:
+    case gl::LINE_STRIP:
+      return ProcessPrimitives<Line>(geometryBuffer, primitives, ProcessLine);
+
+    case gl::TRIANGLES:
+    case gl::TRIANGLE_STRIP:
+    case gl::TRIANGLE_FAN:
+      return ProcessPrimitives<Triangle>(geometryBuffer, primitives, ProcessTriangle);
+
+    default:
+      LOG_CRITICAL("Critical error: Unsupported primitive type encountered !");
+      dial::Critical("Unsupported primitive type !");
     }
   }
-}
 
+  uint32_t CullTriangle(const glm::vec4 *geometryBuffer, const Triangle &triangle, bool cullFront, bool cullBack, bool frontIsCCW)
+  {
+    const glm::vec2 p1 = geometryBuffer[triangle.indices[0]];
+    const glm::vec2 p2 = geometryBuffer[triangle.indices[1]];
+    const glm::vec2 p3 = geometryBuffer[triangle.indices[2]];
+
+    // twice the signed area, the y axis is flipped in screen space so counter clockwise triangles are negative
+    const float area = (p2.x - p1.x) * (p3.y - p1.y) - (p2.y - p1.y) * (p3.x - p1.x);
+    if (!(area != 0.0f)) // degenerate (or NaN)
+      return 0;
+
+    const bool front = (area < 0.0f) == frontIsCCW;
+    if ((front && cullFront) || (!front && cullBack))
+      return 0;
+
+    // a pixel is only drawn if its center (x + 0.5, y + 0.5) is covered, so a triangle whose bounding box
+    // doesn't contain any pixel center can't produce anything
+    const glm::vec2 min = glm::ceil(glm::min(p1, glm::min(p2, p3)) - 0.5f);
+    const glm::vec2 max = glm::floor(glm::max(p1, glm::max(p2, p3)) - 0.5f);
+    if (min.x > max.x || min.y > max.y)
+      return 0;
+
+    return 1;
+  }
+
+  void CullPrimitives(gl::RenderMode mode, PrimitiveBuffer &primitives)
+  {
+    if (mode != gl::TRIANGLES && mode != gl::TRIANGLE_STRIP && mode != gl::TRIANGLE_FAN)
+      return;
+
+    const Context &context = *Context::Instance();
+    const glm::vec4 *geometry = context.GetGeometryBuffer().data();
+
+    const bool culling = context.IsEnabled(gl::CULL_FACE);
+    const gl::Face face = context.GetCullFace();
+
+    const bool cullFront  = culling && (face == gl::FRONT || face == gl::FRONT_AND_BACK);
+    const bool cullBack   = culling && (face == gl::BACK  || face == gl::FRONT_AND_BACK);
+    const bool frontIsCCW = context.GetFrontFace() == gl::CCW;
+
+    CompactPrimitives<Triangle>(primitives, [geometry, cullFront, cullBack, frontIsCCW](uint32_t /*idx*/, const Triangle &triangle) {
+      return CullTriangle(geometry, triangle, cullFront, cullBack, frontIsCCW);
+    });
+  }
+}
@@ -3,13 +3,116 @@
 #include "graphics/gl.hpp"
 #include "graphics/primitives/Primitives.hpp"
 
+#include <glm/vec4.hpp>
+
+#include <array>
+#include <mutex>
+#include <vector>
+
 namespace PrimitiveProcessor
 {
-  PrimitiveBuffer::iterator ProcessPoint(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, PrimitiveBuffer::piterator<Point> point);
-  PrimitiveBuffer::iterator ProcessLine(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, PrimitiveBuffer::piterator<Line> line);
-  PrimitiveBuffer::iterator ProcessTriangle(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, PrimitiveBuffer::piterator<Triangle> triangle);
+  // Set in the result of a process function when the resulting primitives come from the ClipResults
+  constexpr uint32_t CLIPPED = 0x80000000;
+
+  // Vertices and primitives created by the clipping, shared by every thread of the processing pass.
+  // New vertices are kept apart and only appended to the geometry buffer once the pass is done,
+  // so the geometry buffer is never reallocated while being read.
+  template<class Primitive>
+  struct ClipResults
+  {
+    struct Clipped
+    {
+      uint32_t source; // index of the primitive it was clipped from
+      uint32_t rank;   // index among the primitives clipped from the same source
+      Primitive primitive;
+    };
+
+    // a new vertex is a weighted sum of (up to) 3 vertices of the source primitive, its varyings are computed the same way
+    struct Source
+    {
+      std::array<unsigned, 3> indices;
+      glm::vec3 weights;
+    };
+
+    std::mutex mutex;
+
+    size_t firstVertex = 0;
+    std::vector<glm::vec4> vertices;
+    std::vector<Source> sources;
+    std::vector<Clipped> primitives;
+
+    // mutex must be held by the caller
+    unsigned AddVertex(const glm::vec4 &pos, const std::array<unsigned, 3> &indices, const glm::vec3 &weights)
+    {
+      vertices.push_back(pos);
+      sources.push_back({ indices, weights });
+      return unsigned(firstVertex + vertices.size() - 1);
+    }
+  };
+
+  // The vertex is inside of the clipping volume (no primitive is ever clipped at it)
+  inline bool IsInside(const glm::vec4 &pos)
+  {
+    return pos.x >= -pos.w && pos.x < pos.w
+        && pos.y >= -pos.w && pos.y < pos.w
+        && pos.z >= -pos.w && pos.z < pos.w;
+  }
+
+  // Perspective division and viewport transform, depth goes from [-1, 1] to [0, 1] and w is replaced by 1 / w
+  inline void ToScreenSpace(glm::vec4 &pos, const glm::vec4 &viewport)
+  {
+    const float inv_w = 1.0f / pos.w;
+    pos *= inv_w;
+    pos.w = inv_w;
 
-  PrimitiveBuffer::iterator ProcessPrimitive(std::vector<glm::vec4> &geometryBuffer, PrimitiveBuffer &primitives, PrimitiveBuffer::iterator primitive);
+    pos.x = ( pos.x + 1.0f) * (0.5f * viewport.z) + viewport.x;
+    pos.y = (-pos.y + 1.0f) * (0.5f * viewport.w) + viewport.y;
+    pos.z = ( pos.z + 1.0f) * 0.5f;
+  }
 
+  // Inverse of ToScreenSpace
+  inline glm::vec4 ToClipSpace(const glm::vec4 &pos, const glm::vec4 &viewport)
+  {
+    const float w = 1.0f / pos.w;
+
+    return {
+      ( (pos.x - viewport.x) / (0.5f * viewport.z) - 1.0f) * w,
+      (-(pos.y - viewport.y) / (0.5f * viewport.w) + 1.0f) * w,
+      (pos.z * 2.0f - 1.0f) * w,
+      w
+    };
+  }
+
+  // Geometry buffer as seen by the clipping: the vertices inside of the clipping volume are already in screen space
+  // (projected by the vertex stage, see Pipeline::ProjectVertices), the others are still in clip space
+  struct ClipGeometry
+  {
+    const glm::vec4 *positions;
+    const uint8_t *projected; // projected[i] is set if positions[i] is in screen space
+    glm::vec4 viewport;
+
+    bool Projected(unsigned idx) const { return projected[idx]; }
+
+    // clip space position of a vertex, recomputed for the projected ones
+    glm::vec4 operator[](unsigned idx) const
+    {
+      return projected[idx] ? ToClipSpace(positions[idx], viewport) : positions[idx];
+    }
+  };
+
+  // Returns the amount of primitives the primitive idx results in (0 if rejected)
+  template<class Primitive>
+  using ProcessFunction = uint32_t (*)(const ClipGeometry &geometryBuffer, uint32_t idx, const Primitive &primitive, ClipResults<Primitive> &results);
+
+  uint32_t ProcessPoint(const ClipGeometry &geometryBuffer, uint32_t idx, const Point &point, ClipResults<Point> &results);
+  uint32_t ProcessLine(const ClipGeometry &geometryBuffer, uint32_t idx, const Line &line, ClipResults<Line> &results);
+  uint32_t ProcessTriangle(const ClipGeometry &geometryBuffer, uint32_t idx, const Triangle &triangle, ClipResults<Triangle> &results);
+
+  // Clips the primitives, then moves every vertex that is still in clip space (including the new ones) to screen space
   void ProcessPrimitives(gl::RenderMode mode, PrimitiveBuffer &primitives);
+
+  // Runs on screen space coordinates, removes the degenerate triangles, the ones that don't cover any pixel center
+  // and, if CULL_FACE is enabled, the ones facing the culled side
+  uint32_t CullTriangle(const glm::vec4 *geometryBuffer, const Triangle &triangle, bool cullFront, bool cullBack, bool frontIsCCW);
+  void CullPrimitives(gl::RenderMode mode, PrimitiveBuffer &primitives);
 }
\ No newline at end of file
@@ -2,10 +2,17 @@
 #include "Dialogs.hpp"
 
 #include "core/Log.hpp"
+#include "core/Core.hpp"
 #include "graphics/Context.hpp"
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+#include <optional>
+#include <cmath>
+
+#include <immintrin.h>
+
 // Draw a line using the Bresenham algorithm
 //template<class Func>
 void DrawLine(FrameBuffer &framebuffer, glm::vec2 p1, glm::vec2 p2, uint32_t color)
@@ -52,6 +59,169 @@ void DrawLine(FrameBuffer &framebuffer, glm::vec2 p1, glm::vec2 p2, uint32_t col
   }
 }
 
+// Edge function of the edge (a, b) evaluated at p, also equals twice the signed area of the triangle (a, b, p)
+static inline float EdgeFunction(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &p)
+{
+  return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+}
+
+// Top-left fill rule: a pixel center lying exactly on an edge is only drawn if it's a top or a left edge
+// so pixels on edges shared by two triangles are drawn exactly once
+static inline bool IsTopLeft(const glm::vec2 &a, const glm::vec2 &b)
+{
+  const glm::vec2 delta = b - a;
+  return (delta.y < 0.0f) || (delta.y == 0.0f && delta.x > 0.0f);
+}
+
+// Pixels of a 2x2 quad are stored in the SIMD lanes as follow:
+//   lane 0: (x, y)     lane 1: (x + 1, y)
+//   lane 2: (x, y + 1) lane 3: (x + 1, y + 1)
+// so the coverage mask of a quad has the top row in bits 0-1 and the bottom row in bits 2-3
+constexpr int QUAD_TOP_ROW    = BIT(0) | BIT(1);
+constexpr int QUAD_BOTTOM_ROW = BIT(2) | BIT(3);
+constexpr int QUAD_LEFT_COL   = BIT(0) | BIT(2);
+constexpr int QUAD_RIGHT_COL  = BIT(1) | BIT(3);
+
+// expands a 4 bits coverage mask into a SIMD lane mask
+static inline __m128 QuadLaneMask(int coverage)
+{
+  return _mm_castsi128_ps(_mm_setr_epi32(
+    -(coverage & 1), -((coverage >> 1) & 1), -((coverage >> 2) & 1), -((coverage >> 3) & 1)
+  ));
+}
+
+// Edge function of one triangle edge evaluated on the 4 pixel centers of a quad
+struct QuadEdge
+{
+  QuadEdge(const glm::vec2 &a, const glm::vec2 &b, glm::ivec2 quad)
+  {
+    const __m128 laneX = _mm_setr_ps(0.5f, 1.5f, 0.5f, 1.5f);
+    const __m128 laneY = _mm_setr_ps(0.5f, 0.5f, 1.5f, 1.5f);
+
+    // E(p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x), evaluated relative to a to keep the precision
+    const __m128 px = _mm_add_ps(_mm_set1_ps(float(quad.x) - a.x), laneX);
+    const __m128 py = _mm_add_ps(_mm_set1_ps(float(quad.y) - a.y), laneY);
+
+    const __m128 dx = _mm_set1_ps(b.x - a.x);
+    const __m128 dy = _mm_set1_ps(b.y - a.y);
+
+    value = _mm_sub_ps(_mm_mul_ps(dx, py), _mm_mul_ps(dy, px));
+
+    // moving one quad (two pixels) to the right changes the edge function by 2 * (a.y - b.y)
+    step = _mm_set1_ps(2.0f * (a.y - b.y));
+    topLeft = IsTopLeft(a, b) ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+  }
+
+  // returns all bits set in the lanes whose pixel is on the inside of the edge
+  __m128 Inside() const
+  {
+    const __m128 zero = _mm_setzero_ps();
+    return _mm_or_ps(_mm_cmpgt_ps(value, zero), _mm_and_ps(_mm_cmpeq_ps(value, zero), topLeft));
+  }
+
+  void Step() { value = _mm_add_ps(value, step); }
+
+  __m128 value;
+  __m128 step;
+  __m128 topLeft;
+};
+
+// Packs a color in the uint32_t format of the framebuffers (0xAABBGGRR)
+static inline uint32_t PackColor(const glm::vec4 &color)
+{
+  const glm::vec4 c = glm::clamp(color, glm::vec4(0.0f), glm::vec4(1.0f)) * 255.0f + 0.5f;
+  return uint32_t(c.r) | (uint32_t(c.g) << 8) | (uint32_t(c.b) << 16) | (uint32_t(c.a) << 24);
+}
+
+// Accumulates the adjacent covered pixels of a row so they are written with a single framebuffer call
+class SpanWriter
+{
+public:
+  static constexpr unsigned int MAX_SHADED_LENGTH = 32;
+
+public:
+  SpanWriter(FrameBuffer &framebuffer, int y, uint32_t color) : m_framebuffer(framebuffer), m_y(y), m_color(color) {}
+  ~SpanWriter() { Flush(); }
+
+  // pixels must be pushed from left to right without skipping any of them
+  void Push(int x, bool covered)
+  {
+    if (!covered)
+      return Flush();
+
+    if (m_length == 0)
+      m_start = x;
+    ++m_length;
+  }
+
+  // same as above but every pixel has its own color
+  void Push(int x, bool covered, uint32_t color)
+  {
+    if (!covered || m_length == MAX_SHADED_LENGTH)
+      Flush();
+    if (!covered)
+      return;
+
+    if (m_length == 0)
+      m_start = x;
+    m_colors[m_length++] = color;
+    m_shaded = true;
+  }
+
+  void Flush()
+  {
+    if (m_length == 0)
+      return;
+
+    if (m_shaded)
+      m_framebuffer.WriteSpan(m_start, m_y, m_length, m_colors);
+    else
+      m_framebuffer.FillSpan(m_start, m_y, m_length, m_color);
+    m_length = 0;
+  }
+
+private:
+  FrameBuffer &m_framebuffer;
+
+  const int m_y;
+  const uint32_t m_color;
+
+  int m_start = 0;
+  unsigned int m_length = 0;
+
+  bool m_shaded = false;
+  uint32_t m_colors[MAX_SHADED_LENGTH];
+};
+
+// Computes the range of pixels whose center is inside the bounding box of the triangle (clamped to [clipMin, clipMax])
+// returns false if no pixel center can be covered
+static bool TriangleBounds(const glm::vec2 &p1, const glm::vec2 &p2, const glm::vec2 &p3, glm::ivec2 clipMin, glm::ivec2 clipMax, glm::ivec2 &min, glm::ivec2 &max)
+{
+  glm::vec2 lo = glm::min(p1, glm::min(p2, p3));
+  glm::vec2 hi = glm::max(p1, glm::max(p2, p3));
+
+  if (!std::isfinite(lo.x) || !std::isfinite(lo.y) || !std::isfinite(hi.x) || !std::isfinite(hi.y))
+    return false;
+
+  // the pixel x is covered only if it's center (x + 0.5) is inside [lo, hi]
+  lo = glm::max(glm::ceil(lo - 0.5f), glm::vec2(clipMin));
+  hi = glm::min(glm::floor(hi - 0.5f), glm::vec2(clipMax));
+
+  min = glm::ivec2(lo);
+  max = glm::ivec2(hi);
+  return min.x <= max.x && min.y <= max.y;
+}
+
+static inline float TriangleMinDepth(const glm::vec4 *geometryBuffer, const Triangle &triangle)
+{
+  return std::min(geometryBuffer[triangle.indices[0]].z, std::min(geometryBuffer[triangle.indices[1]].z, geometryBuffer[triangle.indices[2]].z));
+}
+
+static inline float TriangleMaxDepth(const glm::vec4 *geometryBuffer, const Triangle &triangle)
+{
+  return std::max(geometryBuffer[triangle.indices[0]].z, std::max(geometryBuffer[triangle.indices[1]].z, geometryBuffer[triangle.indices[2]].z));
+}
+
 namespace PrimitiveRenderer
 {
   void RenderPoint(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Point &point)
@@ -64,8 +234,11 @@ namespace PrimitiveRenderer
 
   void RenderLine(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Line &line)
   {
-    glm::vec2 p1 = geometryBuffer[line.indices[0]];
-    glm::vec2 p2 = geometryBuffer[line.indices[1]];
+    // clipped end points can lie exactly on the right or bottom edge of the viewport
+    const glm::vec2 clipMax = { float(framebuffer.Width() - 1), float(framebuffer.Height() - 1) };
+
+    glm::vec2 p1 = glm::clamp(glm::vec2(geometryBuffer[line.indices[0]]), glm::vec2(0.0f), clipMax);
+    glm::vec2 p2 = glm::clamp(glm::vec2(geometryBuffer[line.indices[1]]), glm::vec2(0.0f), clipMax);
 
     LOG_TRACE("  Drawing Line: [\n"
       "    {{ {:5.2}, {:5.2} }}\n"
@@ -77,6 +250,147 @@ namespace PrimitiveRenderer
     DrawLine(framebuffer, p1, p2, 0xffffffff);
   }
 
+  void RenderTriangle(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Triangle &triangle, glm::ivec2 clipMin, glm::ivec2 clipMax, const RasterState &state, bool depthPass)
+  {
+    unsigned i1 = triangle.indices[0];
+    unsigned i2 = triangle.indices[1];
+    unsigned i3 = triangle.indices[2];
+
+    // make sure the inside of the triangle is on the positive side of every edges
+    const float area = EdgeFunction(geometryBuffer[i1], geometryBuffer[i2], geometryBuffer[i3]);
+    if (area == 0.0f)
+      return;
+    if (area < 0.0f)
+      std::swap(i2, i3);
+
+    const glm::vec2 p1 = geometryBuffer[i1];
+    const glm::vec2 p2 = geometryBuffer[i2];
+    const glm::vec2 p3 = geometryBuffer[i3];
+
+    glm::ivec2 min;
+    glm::ivec2 max;
+    if (!TriangleBounds(p1, p2, p3, clipMin, clipMax, min, max))
+      return;
+
+    // quads are aligned on even pixels so they never straddle two tiles
+    const glm::ivec2 first = { min.x & ~1, min.y & ~1 };
+
+    DepthBuffer *depth = state.depth;
+    const IFragmentShader *shader = state.shader;
+
+    // the edge functions are the barycentric weights of the opposite vertices scaled by the area,
+    // screen space depth is linear so it's interpolated with them directly
+    const __m128 invArea = _mm_set1_ps(1.0f / std::abs(area));
+    const __m128 z1 = _mm_set1_ps(geometryBuffer[i1].z);
+    const __m128 z2 = _mm_set1_ps(geometryBuffer[i2].z);
+    const __m128 z3 = _mm_set1_ps(geometryBuffer[i3].z);
+
+    // the varyings are linear in clip space, they are interpolated with the weights divided by w (w holds 1 / w here)
+    const __m128 invW1 = _mm_set1_ps(geometryBuffer[i1].w);
+    const __m128 invW2 = _mm_set1_ps(geometryBuffer[i2].w);
+    const __m128 invW3 = _mm_set1_ps(geometryBuffer[i3].w);
+
+    const size_t varyingCount = state.varyingCount;
+    const float *v1 = state.varyings + i1 * varyingCount;
+    const float *v2 = state.varyings + i2 * varyingCount;
+    const float *v3 = state.varyings + i3 * varyingCount;
+
+    FragmentQuad quad;
+    glm::vec4 colors[4];
+
+    for (int qy = first.y; qy <= max.y; qy += 2)
+    {
+      QuadEdge e1(p2, p3, { first.x, qy });
+      QuadEdge e2(p3, p1, { first.x, qy });
+      QuadEdge e3(p1, p2, { first.x, qy });
+
+      // discard the pixels of the quads that are outside of the bounds
+      const int rowMask = (qy >= min.y ? QUAD_TOP_ROW : 0) | (qy + 1 <= max.y ? QUAD_BOTTOM_ROW : 0);
+
+      SpanWriter top(framebuffer, qy, 0xffffffff);
+      SpanWriter bottom(framebuffer, qy + 1, 0xffffffff);
+
+      for (int qx = first.x; qx <= max.x; qx += 2)
+      {
+        const int colMask = (qx >= min.x ? QUAD_LEFT_COL : 0) | (qx + 1 <= max.x ? QUAD_RIGHT_COL : 0);
+
+        const __m128 inside = _mm_and_ps(e1.Inside(), _mm_and_ps(e2.Inside(), e3.Inside()));
+        int coverage = _mm_movemask_ps(inside) & rowMask & colMask;
+
+        __m128 z = _mm_setzero_ps();
+        if ((depth || shader) && coverage)
+        {
+          z = _mm_mul_ps(_mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(e1.value, z1),
+            _mm_mul_ps(e2.value, z2)),
+            _mm_mul_ps(e3.value, z3)), invArea);
+        }
+
+        if (depth && coverage)
+        {
+          __m64 *top_depth    = reinterpret_cast<__m64 *>(depth->Row(qy) + qx);
+          __m64 *bottom_depth = reinterpret_cast<__m64 *>(depth->Row(qy + 1) + qx);
+
+          const __m128 stored = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), top_depth), bottom_depth);
+
+          if (!depthPass)
+            coverage &= _mm_movemask_ps(_mm_cmplt_ps(z, stored));
+
+          const __m128 mask = QuadLaneMask(coverage);
+          const __m128 written = _mm_or_ps(_mm_and_ps(mask, z), _mm_andnot_ps(mask, stored));
+
+          _mm_storel_pi(top_depth, written);
+          _mm_storeh_pi(bottom_depth, written);
+        }
+
+        if (!shader)
+        {
+          top.Push(qx,        coverage & BIT(0));
+          top.Push(qx + 1,    coverage & BIT(1));
+          bottom.Push(qx,     coverage & BIT(2));
+          bottom.Push(qx + 1, coverage & BIT(3));
+        }
+        else if (!coverage)
+        {
+          top.Flush();
+          bottom.Flush();
+        }
+        else
+        {
+          quad.position = { qx, qy };
+          quad.coverage = coverage;
+          _mm_store_ps(quad.depth, z);
+
+          const __m128 w1 = _mm_mul_ps(e1.value, invW1);
+          const __m128 w2 = _mm_mul_ps(e2.value, invW2);
+          const __m128 w3 = _mm_mul_ps(e3.value, invW3);
+          const __m128 invSum = _mm_div_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_add_ps(w1, w2), w3));
+
+          for (size_t v = 0; v < varyingCount; ++v)
+          {
+            const __m128 value = _mm_add_ps(_mm_add_ps(
+              _mm_mul_ps(w1, _mm_set1_ps(v1[v])),
+              _mm_mul_ps(w2, _mm_set1_ps(v2[v]))),
+              _mm_mul_ps(w3, _mm_set1_ps(v3[v])));
+
+            _mm_store_ps(quad.varyings[v], _mm_mul_ps(value, invSum));
+          }
+
+          (*shader)(quad, colors);
+
+          top.Push(qx,        coverage & BIT(0), PackColor(colors[0]));
+          top.Push(qx + 1,    coverage & BIT(1), PackColor(colors[1]));
+          bottom.Push(qx,     coverage & BIT(2), PackColor(colors[2]));
+          bottom.Push(qx + 1, coverage & BIT(3), PackColor(colors[3]));
+        }
+
+        e1.Step();
+        e2.Step();
+        e3.Step();
+      }
+    }
+  }
+
   void RenderTriangle(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Triangle &triangle)
   {
     const glm::vec4 &p1 = geometryBuffer[triangle.indices[0]];
@@ -92,6 +406,9 @@ namespace PrimitiveRenderer
       p2.x, p2.y, p2.z, p2.w,
       p3.x, p3.y, p3.z, p3.w
     );
+
+    const glm::ivec2 clipMax = { int(framebuffer.Width()) - 1, int(framebuffer.Height()) - 1 };
+    return RenderTriangle(framebuffer, geometryBuffer, triangle, { 0, 0 }, clipMax, RasterState());
   }
 
   void RenderPrimitive(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const IPrimitive &primitive)
@@ -110,16 +427,113 @@ namespace PrimitiveRenderer
     }
   }
 
-  void RenderPrimitives(const PrimitiveBuffer &primitives)
+  void BinTriangles(TileBuffer &tiles, const FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const PrimitiveBuffer &primitives, const DepthBuffer *depth)
+  {
+    const glm::ivec2 clipMax = { int(framebuffer.Width()) - 1, int(framebuffer.Height()) - 1 };
+
+    tiles.Resize(framebuffer.Width(), framebuffer.Height());
+
+    uint32_t idx = 0;
+    for (PrimitiveBuffer::piterator<Triangle> it = primitives.pbegin<Triangle>(); it != primitives.pend<Triangle>(); ++it, ++idx)
+    {
+      const glm::vec2 p1 = geometryBuffer[it->indices[0]];
+      const glm::vec2 p2 = geometryBuffer[it->indices[1]];
+      const glm::vec2 p3 = geometryBuffer[it->indices[2]];
+
+      glm::ivec2 min;
+      glm::ivec2 max;
+      if (!TriangleBounds(p1, p2, p3, { 0, 0 }, clipMax, min, max))
+        continue;
+
+      // hidden behind what the previous draws left in every tile it overlaps
+      if (depth && depth->Occluded(min, max, TriangleMinDepth(geometryBuffer, *it)))
+        continue;
+
+      tiles.Insert(idx, min, max);
+    }
+  }
+
+  void RenderTriangles(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const PrimitiveBuffer &primitives, TileBuffer &tiles, const RasterState &state)
+  {
+    const Triangle *triangles = &*primitives.pbegin<Triangle>();
+    DepthBuffer *depth = state.depth;
+
+    // every tile only touches it's own pixels (and depth), so they can all be rasterized at the same time
+    Context::Instance()->GetThreadPool().ForEach(tiles.begin(), tiles.end(), [&framebuffer, geometryBuffer, triangles, &state, depth](const TileBuffer::Tile &tile) {
+      if (!depth)
+      {
+        for (const uint32_t idx : tile.primitives)
+          RenderTriangle(framebuffer, geometryBuffer, triangles[idx], tile.min, tile.max, state);
+        return;
+      }
+
+      DepthBuffer::Tile &hiz = depth->GetTile(tile.min);
+      bool written = false;
+
+      for (const uint32_t idx : tile.primitives)
+      {
+        const Triangle &triangle = triangles[idx];
+
+        const float zmin = TriangleMinDepth(geometryBuffer, triangle);
+        const float zmax = TriangleMaxDepth(geometryBuffer, triangle);
+
+        // farther than every pixel of the tile
+        if (zmin >= hiz.max)
+          continue;
+
+        // closer than every pixel of the tile, no need to read the depth buffer
+        const bool pass = zmax < hiz.min;
+
+        RenderTriangle(framebuffer, geometryBuffer, triangle, tile.min, tile.max, state, pass);
+
+        // the max can only decrease, keeping the old one is conservative, the min however must follow the writes
+        hiz.min = std::min(hiz.min, zmin);
+        written = true;
+      }
+
+      if (written)
+        depth->UpdateTile(tile.min, tile.max);
+    }, 1);
+  }
+
+  void RenderPrimitives(gl::RenderMode mode, const PrimitiveBuffer &primitives)
   {
     Context &context = *Context::Instance();
 
     FrameBuffer &framebuffer = context.GetFrameBuffer();
     const glm::vec4 *geometryBuffer = context.GetGeometryBuffer().data();
 
-    for (const IPrimitive &primitive : primitives)
+    switch (mode)
+    {
+    case gl::TRIANGLES:
+    case gl::TRIANGLE_STRIP:
+    case gl::TRIANGLE_FAN:
     {
-      RenderPrimitive(framebuffer, geometryBuffer, primitive);
+      TileBuffer &tiles = context.GetTileBuffer();
+
+      RasterState state;
+      if (context.IsEnabled(gl::DEPTH_TEST))
+      {
+        state.depth = &framebuffer.GetDepthBuffer();
+        state.depth->Resize(framebuffer.Width(), framebuffer.Height());
+      }
+
+      std::optional<Program *> program = context.GetBoundProgram();
+      if (program.has_value())
+        state.shader = program.value()->GetFragmentShader();
+
+      state.varyings = context.GetVaryingBuffer().data();
+      state.varyingCount = context.GetVaryingCount();
+
+      BinTriangles(tiles, framebuffer, geometryBuffer, primitives, state.depth);
+      return RenderTriangles(framebuffer, geometryBuffer, primitives, tiles, state);
+    }
+
+    default:
+      for (const IPrimitive &primitive : primitives)
+      {
+        RenderPrimitive(framebuffer, geometryBuffer, primitive);
+      }
     }
   }
 }
\ No newline at end of file
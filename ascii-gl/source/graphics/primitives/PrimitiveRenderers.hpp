@@ -2,15 +2,35 @@
 
 #include "graphics/gl.hpp"
 #include "graphics/FrameBuffer.hpp"
+#include "graphics/Shader.hpp"
 #include "graphics/primitives/Primitives.hpp"
+#include "graphics/primitives/TileBuffer.hpp"
 
 namespace PrimitiveRenderer
 {
+  // What the triangles of a draw call are rendered with
+  struct RasterState
+  {
+    DepthBuffer *depth = nullptr;            // no depth test if null
+    const IFragmentShader *shader = nullptr; // pixels are drawn white if null
+    const float *varyings = nullptr;         // varying buffer, varyingCount floats per vertex
+    size_t varyingCount = 0;
+  };
+
   void RenderPoint(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Point &primitive);
   void RenderLine(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Line &primitive);
   void RenderTriangle(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Triangle &primitive);
+  // if a depth buffer is set, the pixels are depth tested (LESS) and their depth is written,
+  // depthPass tells that every pixel is already known to pass the test so only the writes remain
+  void RenderTriangle(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const Triangle &primitive, glm::ivec2 clipMin, glm::ivec2 clipMax, const RasterState &state, bool depthPass = false);
 
   void RenderPrimitive(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const IPrimitive &primitive);
 
-  void RenderPrimitives(const PrimitiveBuffer &primitives);
+  // Sorts the triangles into the screen tiles they overlap
+  // (the triangles hidden by the depth buffer are dropped)
+  void BinTriangles(TileBuffer &tiles, const FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const PrimitiveBuffer &primitives, const DepthBuffer *depth = nullptr);
+  // Rasterizes the binned triangles, every tile in parallel
+  void RenderTriangles(FrameBuffer &framebuffer, const glm::vec4 *geometryBuffer, const PrimitiveBuffer &primitives, TileBuffer &tiles, const RasterState &state);
+
+  void RenderPrimitives(gl::RenderMode mode, const PrimitiveBuffer &primitives);
 }
\ No newline at end of file
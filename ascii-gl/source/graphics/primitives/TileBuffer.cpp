@@ -0,0 +1,51 @@
+#include "graphics/primitives/TileBuffer.hpp"
+
+#include <algorithm>
+
+void TileBuffer::Resize(unsigned int width, unsigned int height)
+{
+  if (width == m_pixelWidth && height == m_pixelHeight)
+    return Clear();
+
+  m_pixelWidth = width;
+  m_pixelHeight = height;
+
+  m_width  = (width  + TILE_SIZE - 1) / TILE_SIZE;
+  m_height = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+  m_tiles.resize(size_t(m_width) * m_height);
+
+  for (unsigned int ty = 0; ty < m_height; ++ty)
+  {
+    for (unsigned int tx = 0; tx < m_width; ++tx)
+    {
+      Tile &tile = m_tiles[ty * m_width + tx];
+
+      tile.min = glm::ivec2(tx * TILE_SIZE, ty * TILE_SIZE);
+      tile.max = glm::ivec2(
+        std::min((tx + 1) * TILE_SIZE, width)  - 1,
+        std::min((ty + 1) * TILE_SIZE, height) - 1
+      );
+    }
+  }
+
+  return Clear();
+}
+
+void TileBuffer::Clear()
+{
+  for (Tile &tile : m_tiles)
+    tile.primitives.clear();
+}
+
+void TileBuffer::Insert(uint32_t primitive, glm::ivec2 min, glm::ivec2 max)
+{
+  const glm::ivec2 tmin = min / int(TILE_SIZE);
+  const glm::ivec2 tmax = max / int(TILE_SIZE);
+
+  for (int ty = tmin.y; ty <= tmax.y; ++ty)
+  {
+    for (int tx = tmin.x; tx <= tmax.x; ++tx)
+      m_tiles[ty * m_width + tx].primitives.push_back(primitive);
+  }
+}
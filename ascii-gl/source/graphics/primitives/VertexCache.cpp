@@ -0,0 +1,72 @@
+#include "graphics/primitives/VertexCache.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+size_t VertexCache::TableSize(size_t indicesCount)
+{
+  size_t size = 16;
+  while (size < 2 * indicesCount)
+    size *= 2;
+  return size;
+}
+
+template<class Index>
+bool VertexCache::Build(size_t vertexCount, size_t indicesCount, const Index *indices)
+{
+  const size_t tableSize = TableSize(indicesCount);
+  const bool direct = vertexCount <= tableSize;
+  const size_t mask = tableSize - 1;
+
+  if (m_stamps.size() < tableSize)
+  {
+    m_stamps.resize(tableSize, 0);
+    m_keys.resize(tableSize);
+    m_slots.resize(tableSize);
+  }
+
+  // every stamp would be considered valid again on overflow
+  if (++m_generation == 0)
+  {
+    std::fill(m_stamps.begin(), m_stamps.end(), 0);
+    m_generation = 1;
+  }
+
+  m_vertices.clear();
+  m_indices.resize(indicesCount);
+
+  for (size_t i = 0; i < indicesCount; ++i)
+  {
+    const Index index = indices[i];
+    if constexpr (std::is_signed_v<Index>)
+    {
+      if (index < 0)
+        return false;
+    }
+    if (size_t(index) >= vertexCount)
+      return false;
+
+    // linear probing, the multiplier is odd so the consecutive vertices don't collide
+    size_t entry = size_t(index);
+    if (!direct)
+    {
+      entry = (uint32_t(index) * 0x9E3779B1u) & mask;
+      while (m_stamps[entry] == m_generation && m_keys[entry] != uint32_t(index))
+        entry = (entry + 1) & mask;
+    }
+
+    if (m_stamps[entry] != m_generation)
+    {
+      m_stamps[entry] = m_generation;
+      m_keys[entry] = uint32_t(index);
+      m_slots[entry] = unsigned(m_vertices.size());
+      m_vertices.push_back(unsigned(index));
+    }
+    m_indices[i] = m_slots[entry];
+  }
+  return true;
+}
+
+template bool VertexCache::Build<int>(size_t, size_t, const int *);
+template bool VertexCache::Build<uint16_t>(size_t, size_t, const uint16_t *);
+template bool VertexCache::Build<uint32_t>(size_t, size_t, const uint32_t *);
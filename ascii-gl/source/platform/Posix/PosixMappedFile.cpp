@@ -0,0 +1,51 @@
+#ifndef _WIN32
+
+#include "MappedFile.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+class PosixMappedFile : public MappedFile
+{
+public:
+  PosixMappedFile(byte_t *data, size_t size) : m_data(data), m_size(size) {}
+
+  ~PosixMappedFile()
+  {
+    munmap(m_data, m_size);
+  }
+
+  virtual byte_t *Data() const override { return m_data; }
+  virtual size_t Size() const override { return m_size; }
+
+private:
+  byte_t *m_data;
+  size_t m_size;
+};
+
+Scope<MappedFile> MappedFile::Open(const std::string &path)
+{
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+
+  // the mapping stays valid once the file is closed
+  void *data = mmap(nullptr, size_t(info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return nullptr;
+
+  return std::make_unique<PosixMappedFile>(static_cast<byte_t *>(data), size_t(info.st_size));
+}
+
+#endif
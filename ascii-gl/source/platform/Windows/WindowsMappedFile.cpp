@@ -0,0 +1,63 @@
+#ifdef _WIN32
+
+#include "MappedFile.hpp"
+
+#include <Windows.h>
+
+class WindowsMappedFile : public MappedFile
+{
+public:
+  WindowsMappedFile(HANDLE file, HANDLE mapping, byte_t *data, size_t size) : m_file(file), m_mapping(mapping), m_data(data), m_size(size) {}
+
+  ~WindowsMappedFile()
+  {
+    if (m_data)
+      UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+  }
+
+  virtual byte_t *Data() const override { return m_data; }
+  virtual size_t Size() const override { return m_size; }
+
+private:
+  HANDLE m_file;
+  HANDLE m_mapping;
+
+  byte_t *m_data;
+  size_t m_size;
+};
+
+Scope<MappedFile> MappedFile::Open(const std::string &path)
+{
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  // empty files can't be mapped
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  if (!mapping)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  if (!data)
+  {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  return std::make_unique<WindowsMappedFile>(file, mapping, static_cast<byte_t *>(data), size_t(size.QuadPart));
+}
+
+#endif
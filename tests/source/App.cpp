@@ -4,6 +4,7 @@
 
 #include "graphics/gl.hpp"
 #include "graphics/Context.hpp"
+#include "graphics/Pipeline.hpp"
 #include "graphics/primitives/Primitives.hpp"
 
 #include <glm/glm.hpp>
@@ -13,15 +14,15 @@
 #include <iomanip>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
 
-struct Vertex : public IVertex
+// plain data vertex (no vtable), its layout is given to the buffer with gl::VertexAttribPointer
+struct Vertex
 {
   Vertex(float i) : position(i) {}
   Vertex(float x, float y, float z) : position(x, y, z) {}
   Vertex(const glm::vec3 &position) : position(position) {}
 
-  virtual ~Vertex() = default;
-
 
   glm::vec3 position;
 };
@@ -29,37 +30,89 @@ struct Vertex : public IVertex
 class VertexShader : public IVertexShader
 {
 public:
-  VertexShader(Program &parent) : IVertexShader(parent) {}
+  // outputs a color (3 floats) to the fragment shader
+  VertexShader(Program &parent) :
+    IVertexShader(parent, 3),
+    u_viewProjection(UniformLocation("u_viewProjection")),
+    u_transform(UniformLocation("u_transform"))
+  {}
+
+  virtual void Begin() override
+  {
+    // the uniforms don't change during a draw call
+    m_modelViewProjection = Uniform<glm::mat4>(u_viewProjection) * Uniform<glm::mat4>(u_transform);
+  }
 
-  virtual glm::vec4 operator()(const IVertex &vertex, size_t idx) const override
+  // generic pipeline, the attributes are read using the layout of the buffer
+  virtual glm::vec4 operator()(const VertexAttributes &attributes, size_t idx, float *varyings) const override
   {
-    return operator()(static_cast<const Vertex&>(vertex), idx);
+    return operator()(Vertex(glm::vec3(attributes[0])), idx, varyings);
   }
 
-  glm::vec4 operator()(const Vertex &vertex, size_t idx) const
+  // whole batches at once: the positions are transformed 4 at a time from the streams of the buffer (STRUCTURE_OF_ARRAYS)
+  virtual void operator()(const VertexBatch &batch) const override
   {
-    const glm::mat4 &u_viewProjection = Uniform<glm::mat4>("u_viewProjection");
-    const glm::mat4 &u_transform      = Uniform<glm::mat4>("u_transform");
+    batch.Transform(0, m_modelViewProjection);
+
+    VertexAttributes attributes;
+    for (size_t i = 0; i < batch.count; ++i)
+    {
+      batch.buffer->Fetch(batch.indices[i], attributes);
+      Color(glm::vec3(attributes[0]), batch.varyings + i * VaryingCount());
+    }
+  }
 
-    glm::vec4 &&result = u_viewProjection * u_transform * glm::vec4(vertex.position, 1);
+  glm::vec4 operator()(const Vertex &vertex, size_t idx, float *varyings) const
+  {
+    Color(vertex.position, varyings);
+    return operator()(vertex, idx);
+  }
+
+  glm::vec4 operator()(const Vertex &vertex, size_t idx) const
+  {
+    glm::vec4 &&result = m_modelViewProjection * glm::vec4(vertex.position, 1);
 
 
     LOG_TRACE("projected: {0:5.2f}, {1:5.2f}, {2:5.2f}, {3:5.2f}", result[0], result[1], result[2], result[3]);
     //printf("%s%llu", idx ? ", " : "", idx);
     return result;
   }
+
+private:
+  // color from the model space position
+  static void Color(const glm::vec3 &position, float *varyings)
+  {
+    varyings[0] = position.x * 0.5f + 0.5f;
+    varyings[1] = position.y * 0.5f + 0.5f;
+    varyings[2] = 1.0f - varyings[0];
+  }
+
+private:
+  // uniform locations
+  const int u_viewProjection;
+  const int u_transform;
+
+  glm::mat4 m_modelViewProjection;
 };
 
 class FragmentShader : public IFragmentShader
 {
 public:
   FragmentShader(Program &parent) : IFragmentShader(parent) {}
+
+  virtual void operator()(const FragmentQuad &quad, glm::vec4 (&colors)[4]) const override
+  {
+    for (int lane = 0; lane < 4; ++lane)
+      colors[lane] = { quad.varyings[0][lane], quad.varyings[1][lane], quad.varyings[2][lane], 1.0f };
+  }
 };
 
 
 
 int vao;
+int ebo;
 int program;
+int u_transform;
 
 App::App()
 {
@@ -105,13 +158,15 @@ App::App()
     program = gl::CreateProgram();
     gl::UseProgram(program);
 
-    gl::CompileShader<VertexShader>();   // triggers a compile error if the VertexShader lacks the call operator
-    gl::CompileShader<FragmentShader>(); // triggers a compile error if the FragmentShader doesn't inherit from IFragmentShader
+    gl::CompileShader<VertexShader>();   // triggers a compile error if the VertexShader overrides none of the call operators
+    gl::CompileShader<FragmentShader>(); // triggers a compile error if the FragmentShader lacks the quad call operator
 
     gl::AttachShader<VertexShader>(program);
     gl::AttachShader<FragmentShader>(program);
 
     gl::LinkProgram(program); // only returns false if the program lacks a vertex or fragment shader
+
+    u_transform = gl::GetUniformLocation(program, "u_transform");
   }
 
   // Create the vertex array object
@@ -135,9 +190,22 @@ App::App()
       //{  0.0f,  0.0f, 0.0f },
     });
 
+    gl::VertexAttribPointer(0, 3, gl::FLOAT, false, offsetof(Vertex, position));
+    gl::VertexStorage(gl::STRUCTURE_OF_ARRAYS); // the positions are also stored as x[], y[], z[] for the vertex shader
+
     gl::BindBuffer(0);
   }
 
+  // Create the element buffer, the indices are uploaded once instead of every frame
+  {
+    gl::CreateElementBuffers(1, &ebo);
+    gl::BindElementBuffer(ebo);
+
+    gl::ElementData<uint16_t>({ 0, 1, 2 });
+
+    gl::BindElementBuffer(0);
+  }
+
   // generate the modelview matrix
   {
     glm::mat4 proj = glm::perspective(glm::radians(60.0f), 1280.0f / 720.0f, 0.1f, 1000.0f);
@@ -174,15 +242,16 @@ void App::Run()
     last = start_time;
 
     gl::BindBuffer(vao);
+    gl::BindElementBuffer(ebo);
     gl::UseProgram(program);
     
     glm::mat4 transform = glm::rotate(glm::identity<glm::mat4>(), glm::radians(start_time * 90.0f), glm::vec3{ 0, 0, 1 });
-    gl::Uniform(program, "u_transform", transform);
+    gl::Uniform(program, u_transform, transform);
 
     //gl::DrawElements(gl::POINTS, { 0, 1, 2 });// { 0, 1, 2, 3, 4, 5, 6, 7, 8 });
 
     //gl::DrawElements(gl::LINES,      { 1, 2 });// { 0, 1, 2, 3, 4, 5, 6, 7, 8 });
-    gl::DrawElements(gl::LINE_LOOP,  { 0, 1, 2 });// { 0, 1, 2, 3, 4, 5, 6, 7, 8 });
+    gl::DrawElementBuffer<Vertex, VertexShader>(gl::LINE_LOOP, 3); // typed pipeline, no virtual call per vertex
     //gl::DrawElements(gl::LINE_STRIP, { 0, 1, 2 });// { 0, 1, 2, 3, 4, 5, 6, 7, 8 });
 
     //gl::DrawElements(gl::TRIANGLES,      { 0, 1, 2 });// { 0, 1, 2, 3, 4, 5, 6, 7, 8 });
@@ -0,0 +1,294 @@
+#include "Tests.hpp"
+
+#include "core/Log.hpp"
+
+#include "graphics/gl.hpp"
+#include "graphics/Context.hpp"
+#include "graphics/Pipeline.hpp"
+#include "graphics/CommandList.hpp"
+#include "graphics/FrameBuffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// framebuffer kept in memory, the colors are packed as 0xAABBGGRR
+class MemoryFrameBuffer : public FrameBuffer
+{
+public:
+  MemoryFrameBuffer(unsigned int width, unsigned int height) { Resize(width, height); }
+
+  virtual unsigned int Width() const override { return m_width; }
+  virtual unsigned int Height() const override { return m_height; }
+
+  virtual void Resize(unsigned int width, unsigned int height) override
+  {
+    m_width = width;
+    m_height = height;
+    m_pixels.assign(size_t(width) * height, 0);
+  }
+
+  virtual void Clear(glm::vec3 color) override { Clear(Pack(glm::vec4(color, 1.0f))); }
+  virtual void Clear(glm::vec4 color) override { Clear(Pack(color)); }
+  virtual void Clear(uint32_t color = 0x00000000) override { m_pixels.assign(m_pixels.size(), color); }
+  virtual void Clear(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 0xff) override { Clear(Pack(red, green, blue, alpha)); }
+
+  virtual void SetPixel(unsigned int x, unsigned int y, uint32_t color) override
+  {
+    if (x < m_width && y < m_height)
+      m_pixels[size_t(y) * m_width + x] = color;
+  }
+  virtual void SetPixel(unsigned int x, unsigned int y, glm::vec3 color) override { SetPixel(x, y, Pack(glm::vec4(color, 1.0f))); }
+  virtual void SetPixel(unsigned int x, unsigned int y, glm::vec4 color) override { SetPixel(x, y, Pack(color)); }
+  virtual void SetPixel(unsigned int x, unsigned int y, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha = 0xff) override
+  {
+    SetPixel(x, y, Pack(red, green, blue, alpha));
+  }
+
+  uint32_t GetPixel(unsigned int x, unsigned int y) const { return m_pixels[size_t(y) * m_width + x]; }
+  const std::vector<uint32_t> &Pixels() const { return m_pixels; }
+
+private:
+  static uint32_t Pack(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+  {
+    return uint32_t(red) | uint32_t(green) << 8 | uint32_t(blue) << 16 | uint32_t(alpha) << 24;
+  }
+
+  static uint32_t Pack(glm::vec4 color)
+  {
+    color = glm::clamp(color, 0.0f, 1.0f) * 255.0f;
+    return Pack(uint8_t(color.r), uint8_t(color.g), uint8_t(color.b), uint8_t(color.a));
+  }
+
+private:
+  unsigned int m_width = 0;
+  unsigned int m_height = 0;
+  std::vector<uint32_t> m_pixels;
+};
+
+class WhiteFragmentShader : public IFragmentShader
+{
+public:
+  WhiteFragmentShader(Program &parent) : IFragmentShader(parent) {}
+
+  virtual void operator()(const FragmentQuad & /*quad*/, glm::vec4 (&colors)[4]) const override
+  {
+    for (int lane = 0; lane < 4; ++lane)
+      colors[lane] = glm::vec4(1.0f);
+  }
+};
+
+// moves the vertices by the offset of the instance, read from the instance buffer
+class InstanceShader : public IVertexShader
+{
+public:
+  InstanceShader(Program &parent) : IVertexShader(parent) {}
+
+  virtual void BeginInstance(size_t instance, const Buffer *instances) override
+  {
+    m_offset = instances ? instances->Get<glm::vec2>(instance) : glm::vec2(0.0f);
+  }
+
+  virtual glm::vec4 operator()(const VertexAttributes &attributes, size_t /*idx*/, float * /*varyings*/) const override
+  {
+    return { attributes[0].x + m_offset.x, attributes[0].y + m_offset.y, 0.0f, 1.0f };
+  }
+
+private:
+  glm::vec2 m_offset = glm::vec2(0.0f);
+};
+
+// draws the vertices as is and counts the draw calls that reached the vertex stage
+class CountingShader : public IVertexShader
+{
+public:
+  CountingShader(Program &parent) : IVertexShader(parent) {}
+
+  virtual void Begin() override { ++drawCount; }
+
+  virtual glm::vec4 operator()(const VertexAttributes &attributes, size_t /*idx*/, float * /*varyings*/) const override
+  {
+    return { attributes[0].x, attributes[0].y, 0.0f, 1.0f };
+  }
+
+  static inline size_t drawCount = 0;
+};
+
+static constexpr unsigned int WIDTH = 16;
+static constexpr unsigned int HEIGHT = 16;
+
+static bool Check(bool condition, const char *test, const char *what)
+{
+  if (!condition)
+    LOG_ERROR("{}: {}", test, what);
+  return condition;
+}
+
+// column of the pixel covering the x coordinate (normalized device coordinates)
+static unsigned int Column(float x)
+{
+  return unsigned((x * 0.5f + 0.5f) * float(WIDTH));
+}
+
+template<class VertexShader>
+static int CreateProgram()
+{
+  const int program = gl::CreateProgram();
+  gl::UseProgram(program);
+
+  gl::CompileShader<VertexShader>();
+  gl::CompileShader<WhiteFragmentShader>();
+
+  gl::AttachShader<VertexShader>(program);
+  gl::AttachShader<WhiteFragmentShader>(program);
+  gl::LinkProgram(program);
+  return program;
+}
+
+// every instance of a point is drawn at the offset its shader read in BeginInstance
+static bool InstancedDraw(MemoryFrameBuffer &framebuffer)
+{
+  constexpr const char *test = "InstancedDraw";
+  const std::vector<glm::vec2> offsets = { { -0.75f, 0.0f }, { -0.25f, 0.0f }, { 0.25f, 0.0f }, { 0.75f, 0.0f } };
+
+  int buffers[2];
+  gl::CreateBuffers(2, buffers);
+
+  gl::BindBuffer(buffers[1]);
+  gl::BufferData<glm::vec2>(offsets);
+
+  gl::BindBuffer(buffers[0]);
+  gl::BufferData<glm::vec3>({ { 0.0f, 0.0f, 0.0f } });
+  gl::VertexAttribPointer(0, 3, gl::FLOAT, false, 0);
+
+  gl::BindInstanceBuffer(buffers[1]);
+  CreateProgram<InstanceShader>();
+
+  framebuffer.Clear();
+  gl::DrawElementsInstanced(gl::POINTS, { 0 }, offsets.size());
+  gl::BindInstanceBuffer(0);
+
+  // one lit pixel per instance, in the column of its offset
+  std::vector<unsigned int> columns;
+  for (unsigned int y = 0; y < HEIGHT; ++y)
+  {
+    for (unsigned int x = 0; x < WIDTH; ++x)
+    {
+      if (framebuffer.GetPixel(x, y))
+        columns.push_back(x);
+    }
+  }
+
+  bool passed = Check(columns.size() == offsets.size(), test, "one pixel per instance expected");
+  for (size_t i = 0; passed && i < offsets.size(); ++i)
+    passed = Check(columns[i] == Column(offsets[i].x), test, "an instance isn't drawn at its own offset");
+  return passed;
+}
+
+struct RecordedDraw
+{
+  gl::RenderMode mode;
+  std::vector<int> indices;
+};
+
+// the draws give the same pixels submitted from a command list as drawn one by one, in `expectedCount` draw calls
+static bool CheckSubmit(MemoryFrameBuffer &framebuffer, const char *test, int program, int buffer, const std::vector<RecordedDraw> &draws, size_t expectedCount)
+{
+  framebuffer.Clear();
+  for (const RecordedDraw &draw : draws)
+    gl::DrawElements(draw.mode, draw.indices);
+  const std::vector<uint32_t> expected = framebuffer.Pixels();
+
+  gl::CommandList commands;
+  commands.UseProgram(program);
+  commands.BindBuffer(buffer);
+  for (const RecordedDraw &draw : draws)
+    commands.DrawElements(draw.mode, draw.indices);
+
+  framebuffer.Clear();
+  CountingShader::drawCount = 0;
+  gl::Submit(commands);
+
+  return Check(CountingShader::drawCount == expectedCount, test, "unexpected number of merged draw calls")
+    && Check(framebuffer.Pixels() == expected, test, "the submitted draws don't match the immediate ones");
+}
+
+// consecutive draws are merged unless the indices of the first one don't make whole primitives
+static bool CommandListMerging(MemoryFrameBuffer &framebuffer)
+{
+  constexpr const char *test = "CommandListMerging";
+
+  int buffer;
+  gl::CreateBuffers(1, &buffer);
+  gl::BindBuffer(buffer);
+  gl::BufferData<glm::vec3>({
+    { -0.9f, -0.9f, 0.0f }, { -0.1f, -0.9f, 0.0f }, { -0.9f,  0.9f, 0.0f }, // left triangle
+    {  0.0f,  0.0f, 0.0f },                                                 // leftover index
+    {  0.1f, -0.9f, 0.0f }, {  0.9f, -0.9f, 0.0f }, {  0.1f,  0.9f, 0.0f }, // right triangle
+  });
+  gl::VertexAttribPointer(0, 3, gl::FLOAT, false, 0);
+
+  const int program = CreateProgram<CountingShader>();
+
+  return CheckSubmit(framebuffer, test, program, buffer, { { gl::TRIANGLES, { 0, 1, 2 } }, { gl::TRIANGLES, { 4, 5, 6 } } }, 1)
+    && CheckSubmit(framebuffer, test, program, buffer, { { gl::TRIANGLES, { 0, 1, 2, 3 } }, { gl::TRIANGLES, { 4, 5, 6 } } }, 2)
+    && CheckSubmit(framebuffer, test, program, buffer, { { gl::LINES, { 0, 5 } }, { gl::LINES, { 1, 6 } } }, 1)
+    && CheckSubmit(framebuffer, test, program, buffer, { { gl::LINES, { 0, 5, 3 } }, { gl::LINES, { 1, 6 } } }, 2);
+}
+
+// a draw split in chunks draws nothing if one of its indices is invalid, even in its last chunk
+static bool ChunkedDraw(MemoryFrameBuffer &framebuffer)
+{
+  constexpr const char *test = "ChunkedDraw";
+
+  int buffer;
+  gl::CreateBuffers(1, &buffer);
+  gl::BindBuffer(buffer);
+  gl::BufferData<glm::vec3>({ { 0.0f, 0.0f, 0.0f } });
+  gl::VertexAttribPointer(0, 3, gl::FLOAT, false, 0);
+
+  CreateProgram<CountingShader>();
+
+  // the smallest chunks
+  const size_t budget = Context::Instance()->GetGeometryBudget();
+  gl::GeometryBudget(1);
+
+  const auto lit = [&framebuffer]() {
+    return std::count_if(framebuffer.Pixels().begin(), framebuffer.Pixels().end(), [](uint32_t pixel) { return pixel != 0; });
+  };
+
+  std::vector<int> indices(4 * Pipeline::MIN_CHUNK_SIZE, 0);
+  framebuffer.Clear();
+  gl::DrawElements(gl::POINTS, indices);
+  const bool drawn = lit() == 1;
+
+  indices.back() = 1;
+  framebuffer.Clear();
+  gl::DrawElements(gl::POINTS, indices);
+  const bool rejected = lit() == 0;
+
+  gl::GeometryBudget(budget);
+  return Check(drawn, test, "the point isn't drawn") && Check(rejected, test, "an invalid index in the last chunk doesn't reject the draw");
+}
+
+namespace Tests
+{
+  int Run()
+  {
+    MemoryFrameBuffer framebuffer(WIDTH, HEIGHT);
+    Context::Instance()->SetFrameBuffer(framebuffer);
+    gl::Viewport(0.0f, 0.0f, float(WIDTH), float(HEIGHT));
+
+    int failed = 0;
+    for (bool (*test)(MemoryFrameBuffer &) : { &InstancedDraw, &CommandListMerging, &ChunkedDraw })
+      failed += !test(framebuffer);
+
+    if (failed)
+      LOG_ERROR("{} test(s) failed", failed);
+    else
+      LOG_INFO("all tests passed");
+    return failed;
+  }
+}
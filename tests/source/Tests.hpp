@@ -0,0 +1,8 @@
+#pragma once
+
+// Draw calls rendered into a framebuffer in memory and checked pixel by pixel, run with `ascii-gl-tests --tests`
+namespace Tests
+{
+  // runs every test, returns the number of failed ones
+  int Run();
+}
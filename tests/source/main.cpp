@@ -1,14 +1,20 @@
 #include <iostream>
 
 #include "App.hpp"
+#include "Tests.hpp"
 #include "Dialogs.hpp"
 
 #include "core/Log.hpp"
 
-int main()
+#include <string_view>
+
+int main(int ac, char **av)
 {
   Log::Init();
   
+  // renders the tests into memory instead of running the app
+  if (ac > 1 && std::string_view(av[1]) == "--tests")
+    return Tests::Run() ? 1 : 0;
   
   SET_LOG_LEVEL(warn);
   